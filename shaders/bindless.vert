@@ -0,0 +1,32 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 0) out vec3 fragColor;
+
+// Storage buffer array of the global bindless table (see BindlessTable), every buffer viewed as per-draw offsets
+layout(set = 0, binding = 1) readonly buffer Offsets {
+    vec4 offsets[];
+} buffers[];
+
+// Handle of the buffer simulate.comp wrote for this frame, the same for the whole draw
+layout(push_constant) uniform Handles {
+    uint offsetBuffer;
+};
+
+vec2 positions[3] = vec2[](
+    vec2(0.0, -0.5),
+    vec2(0.5, 0.5),
+    vec2(-0.5, 0.5)
+);
+
+vec3 colors[3] = vec3[](
+    vec3(1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 0.0, 1.0)
+);
+
+void main() {
+    gl_Position = vec4(positions[gl_VertexIndex] + buffers[offsetBuffer].offsets[gl_InstanceIndex].xy, 0.0, 1.0);
+    fragColor = colors[gl_VertexIndex];
+}
@@ -0,0 +1,58 @@
+# Script mode: cmake -DOUTPUT=<header> -DSPIRVS=<a.spv;b.spv> -P embed_shaders.cmake
+# Writes every SPIR-V module as a constexpr uint32_t array plus a lookup table by file name.
+
+set(ARRAYS "")
+set(ENTRIES "")
+foreach(SPIRV ${SPIRVS})
+    get_filename_component(NAME ${SPIRV} NAME)
+    string(MAKE_C_IDENTIFIER "k_${NAME}" IDENTIFIER)
+    file(READ ${SPIRV} HEX HEX)
+    string(LENGTH "${HEX}" HEX_LENGTH)
+    math(EXPR REMAINDER "${HEX_LENGTH} % 8")
+    if (HEX_LENGTH EQUAL 0 OR NOT REMAINDER EQUAL 0)
+        message(FATAL_ERROR "${SPIRV} is not a whole number of SPIR-V words")
+    endif()
+    # SPIR-V is a stream of little endian words
+    string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1u, " WORDS "${HEX}")
+    # Eight words per line, CMake regular expressions have no repetition counts
+    set(WORD "0x[0-9a-f]+u, ")
+    string(REGEX REPLACE "(${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD})" "\\1\n    " WORDS "${WORDS}")
+    string(REPLACE ", \n" ",\n" WORDS "${WORDS}")
+    string(STRIP "${WORDS}" WORDS)
+    string(APPEND ARRAYS "alignas(4) constexpr uint32_t ${IDENTIFIER}[] = {\n    ${WORDS}\n};\n\n")
+    string(APPEND ENTRIES "    {\"${NAME}\", ${IDENTIFIER}},\n")
+endforeach()
+
+file(WRITE ${OUTPUT}.tmp
+"// Generated by shaders/embed_shaders.cmake, do not edit
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace embedded_shaders {
+
+${ARRAYS}struct Entry {
+    std::string_view name;
+    std::span<const uint32_t> code;
+};
+
+constexpr Entry k_shaders[] = {
+${ENTRIES}};
+
+// Empty span when no shader of that name was embedded
+constexpr std::span<const uint32_t> find(std::string_view name) {
+    for (const Entry& entry : k_shaders) {
+        if (entry.name == name) {
+            return entry.code;
+        }
+    }
+    return {};
+}
+
+}
+")
+# Only touch the header when the shaders changed, so unrelated rebuilds do not recompile main.cpp
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different ${OUTPUT}.tmp ${OUTPUT})
+file(REMOVE ${OUTPUT}.tmp)
@@ -0,0 +1,35 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inColor;
+
+layout(location = 0) out vec3 fragColor;
+
+struct Instance {
+    vec3 position;
+    float scale;
+    vec3 color;
+    uint mesh;
+};
+
+layout(set = 0, binding = 0) readonly buffer Instances {
+    Instance instances[];
+};
+
+// Filled by cull.comp. The mesh's range starts at firstVisible, or at the draw's firstInstance which
+// gl_InstanceIndex already includes when the whole scene goes out as one multi-draw.
+layout(set = 0, binding = 1) readonly buffer Visible {
+    uint visible[];
+};
+
+layout(push_constant) uniform Camera {
+    mat4 viewProjection;
+    uint firstVisible;
+} camera;
+
+void main() {
+    Instance instance = instances[visible[camera.firstVisible + gl_InstanceIndex]];
+    gl_Position = camera.viewProjection * vec4(inPosition * instance.scale + instance.position, 1.0);
+    fragColor = inColor * instance.color;
+}
@@ -0,0 +1,30 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 worldPosition;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform MeshConstants {
+    mat4 viewProjection;
+    vec4 eye;
+    vec4 lights[3]; // xyz towards the light, w intensity
+    vec4 ambient;
+} constants;
+
+void main() {
+    // Flat face normal from the screen space derivatives, so meshes without normals still read as solid.
+    // Its sign depends on the screen orientation, so it is turned towards the camera.
+    vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+    vec3 toEye = normalize(constants.eye.xyz - worldPosition);
+    normal = dot(normal, toEye) < 0.0 ? -normal : normal;
+
+    vec3 light = constants.ambient.rgb;
+    for (int i = 0; i < 3; i++) {
+        vec3 direction = normalize(constants.lights[i].xyz);
+        float diffuse = max(dot(normal, direction), 0.0);
+        float specular = pow(max(dot(normal, normalize(direction + toEye)), 0.0), 32.0) * diffuse;
+        light += constants.lights[i].w * (diffuse + 0.3 * specular);
+    }
+    outColor = vec4(light, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Only the position is consumed, whatever else the mesh file declares stays bound but unused
+layout(location = 0) in vec3 inPosition;
+
+layout(location = 0) out vec3 worldPosition;
+
+// Too large for push constants, bound from the uniform ring with a dynamic offset (MeshConstants in main.cpp)
+layout(set = 0, binding = 0) uniform MeshConstants {
+    mat4 viewProjection;
+    vec4 eye;
+    vec4 lights[3];
+    vec4 ambient;
+} constants;
+
+void main() {
+    gl_Position = constants.viewProjection * vec4(inPosition, 1.0);
+    worldPosition = inPosition;
+}
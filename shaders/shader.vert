@@ -3,6 +3,11 @@
 
 layout(location = 0) out vec3 fragColor;
 
+// Written by simulate.comp on the compute queue, indexed by draw through firstInstance
+layout(set = 0, binding = 0) readonly buffer Offsets {
+    vec4 offsets[];
+};
+
 vec2 positions[3] = vec2[](
     vec2(0.0, -0.5),
     vec2(0.5, 0.5),
@@ -16,6 +21,6 @@ vec3 colors[3] = vec3[](
 );
 
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    gl_Position = vec4(positions[gl_VertexIndex] + offsets[gl_InstanceIndex].xy, 0.0, 1.0);
     fragColor = colors[gl_VertexIndex];
-}
\ No newline at end of file
+}
@@ -0,0 +1,191 @@
+#include "asset_store.hpp"
+
+#include <stdexcept>
+#include <utility>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string& path) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("failed to open " + path + "!");
+    }
+    fileHandle = handle;
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(handle, &fileSize);
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        close();
+        throw std::runtime_error(path + " is empty!");
+    }
+    mappingHandle = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mappingHandle) {
+        close();
+        throw std::runtime_error("failed to map " + path + "!");
+    }
+    bytes = static_cast<const std::byte*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes) {
+        close();
+        throw std::runtime_error("failed to map " + path + "!");
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("failed to open " + path + "!");
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error(path + " is empty or unreadable!");
+    }
+    length = static_cast<size_t>(info.st_size);
+    void* view = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        length = 0;
+        throw std::runtime_error("failed to map " + path + "!");
+    }
+    bytes = static_cast<const std::byte*>(view);
+#endif
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(bytes, other.bytes);
+        std::swap(length, other.length);
+#ifdef _WIN32
+        std::swap(fileHandle, other.fileHandle);
+        std::swap(mappingHandle, other.mappingHandle);
+#endif
+    }
+    return *this;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (bytes) {
+        UnmapViewOfFile(bytes);
+    }
+    if (mappingHandle) {
+        CloseHandle(mappingHandle);
+    }
+    if (fileHandle) {
+        CloseHandle(fileHandle);
+    }
+    fileHandle = nullptr;
+    mappingHandle = nullptr;
+#else
+    if (bytes) {
+        munmap(const_cast<std::byte*>(bytes), length);
+    }
+#endif
+    bytes = nullptr;
+    length = 0;
+}
+
+void MappedFile::adviseSequential(size_t offset, size_t size) const {
+#ifdef _WIN32
+    // FILE_FLAG_SEQUENTIAL_SCAN already asks for read-ahead on the whole file
+    (void)offset;
+    (void)size;
+#else
+    // madvise wants a page aligned start
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t start = offset / pageSize * pageSize;
+    void* address = const_cast<std::byte*>(bytes) + start;
+    madvise(address, size + (offset - start), MADV_SEQUENTIAL);
+    madvise(address, size + (offset - start), MADV_WILLNEED);
+#endif
+}
+
+Asset::~Asset() {
+    close();
+}
+
+Asset::Asset(Asset&& other) noexcept {
+    *this = std::move(other);
+}
+
+Asset& Asset::operator=(Asset&& other) noexcept {
+    if (this != &other) {
+        close();
+        std::swap(data, other.data);
+        std::swap(size, other.size);
+#ifdef __ANDROID__
+        std::swap(asset, other.asset);
+#else
+        file = std::move(other.file);
+#endif
+    }
+    return *this;
+}
+
+void Asset::close() {
+#ifdef __ANDROID__
+    if (asset) {
+        AAsset_close(asset);
+        asset = nullptr;
+    }
+#else
+    file = MappedFile();
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+void Asset::adviseSequential(size_t offset, size_t size) const {
+#ifdef __ANDROID__
+    // The package mapping is managed by the asset manager
+    (void)offset;
+    (void)size;
+#else
+    file.adviseSequential(offset, size);
+#endif
+}
+
+Asset AssetStore::open(const std::string& path) const {
+    Asset result;
+#ifdef __ANDROID__
+    if (!assetManager) {
+        throw std::runtime_error("asset store used before init!");
+    }
+    // Buffer mode hands out the whole asset at once: uncompressed assets point into the mapped APK,
+    // compressed ones are inflated a single time by the asset manager
+    result.asset = AAssetManager_open(assetManager, path.c_str(), AASSET_MODE_BUFFER);
+    if (!result.asset) {
+        throw std::runtime_error("failed to open asset " + path + "!");
+    }
+    result.data = static_cast<const std::byte*>(AAsset_getBuffer(result.asset));
+    result.size = static_cast<size_t>(AAsset_getLength64(result.asset));
+    if (!result.data) {
+        throw std::runtime_error("failed to read asset " + path + "!");
+    }
+#else
+    bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\' || (path.size() > 1 && path[1] == ':'));
+    result.file = MappedFile(absolute || root.empty() ? path : root + "/" + path);
+    result.data = result.file.data();
+    result.size = result.file.size();
+#endif
+    return result;
+}
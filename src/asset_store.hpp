@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#ifdef __ANDROID__
+#include <android/asset_manager.h>
+#endif
+
+// Read-only view of a whole file through the virtual memory system. Pages are faulted in by the kernel
+// as they are touched, so copying from the view costs one pass over the data and no intermediate buffer.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const std::string& path);
+    ~MappedFile();
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const std::byte* data() const { return bytes; }
+    size_t size() const { return length; }
+    // Hints that the range is about to be read front to back, so the kernel reads ahead aggressively
+    void adviseSequential(size_t offset, size_t size) const;
+
+private:
+    void close();
+
+    const std::byte* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+};
+
+// Handle to an opened asset. The bytes stay valid, and are never copied, for as long as the handle lives.
+class Asset {
+public:
+    Asset() = default;
+    ~Asset();
+    Asset(Asset&& other) noexcept;
+    Asset& operator=(Asset&& other) noexcept;
+    Asset(const Asset&) = delete;
+    Asset& operator=(const Asset&) = delete;
+
+    std::span<const std::byte> bytes() const { return {data, size}; }
+    bool isOpen() const { return data != nullptr; }
+    void adviseSequential(size_t offset, size_t size) const;
+
+private:
+    friend class AssetStore;
+    void close();
+
+    const std::byte* data = nullptr;
+    size_t size = 0;
+#ifdef __ANDROID__
+    AAsset* asset = nullptr;
+#else
+    MappedFile file;
+#endif
+};
+
+// Opens the application's read-only assets (shaders, meshes) without copying them.
+// Android reads them from the APK through a single AAssetManager in buffer mode, so uncompressed assets are
+// served straight from the mapped package. Elsewhere they are mapped from a directory on disk.
+// open() may be called from any thread.
+class AssetStore {
+public:
+#ifdef __ANDROID__
+    // The manager must outlive the store, see AAssetManager_fromJava
+    void init(AAssetManager* manager) { assetManager = manager; }
+#else
+    // Relative asset paths are resolved against root
+    void init(std::string root) { this->root = std::move(root); }
+#endif
+    // Throws if the asset does not exist. Absolute paths bypass the root on desktop.
+    Asset open(const std::string& path) const;
+
+private:
+#ifdef __ANDROID__
+    AAssetManager* assetManager = nullptr;
+#else
+    std::string root;
+#endif
+};
@@ -0,0 +1,182 @@
+#include "bindless_table.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+bool BindlessTable::enableFeatures(const vk::PhysicalDeviceVulkan12Features& supported, vk::PhysicalDeviceVulkan12Features& enabled) {
+    bool available = supported.runtimeDescriptorArray && supported.descriptorBindingPartiallyBound &&
+                     supported.descriptorBindingSampledImageUpdateAfterBind && supported.descriptorBindingStorageBufferUpdateAfterBind &&
+                     supported.descriptorBindingUpdateUnusedWhilePending;
+    if (!available) {
+        return false;
+    }
+    enabled.setDescriptorIndexing(supported.descriptorIndexing)
+        .setRuntimeDescriptorArray(true)
+        .setDescriptorBindingPartiallyBound(true)
+        .setDescriptorBindingSampledImageUpdateAfterBind(true)
+        .setDescriptorBindingStorageBufferUpdateAfterBind(true)
+        .setDescriptorBindingUpdateUnusedWhilePending(true)
+        // Optional, needed by shaders indexing with per-instance or per-pixel handles (nonuniformEXT)
+        .setShaderSampledImageArrayNonUniformIndexing(supported.shaderSampledImageArrayNonUniformIndexing)
+        .setShaderStorageBufferArrayNonUniformIndexing(supported.shaderStorageBufferArrayNonUniformIndexing);
+    return true;
+}
+
+void BindlessTable::init(vk::PhysicalDevice physicalDevice, vk::Device device, FramePacer& framePacer) {
+    this->device = device;
+    this->framePacer = &framePacer;
+
+    vk::PhysicalDeviceVulkan12Properties properties12{};
+    vk::PhysicalDeviceProperties2 properties2{};
+    properties2.pNext = &properties12;
+    physicalDevice.getProperties2(&properties2);
+    arrays[SampledImages].capacity = std::min({k_maxSampledImages, properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+                                               properties12.maxPerStageDescriptorUpdateAfterBindSampledImages});
+    arrays[StorageBuffers].capacity = std::min({k_maxStorageBuffers, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers,
+                                                properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+    arrays[Samplers].capacity = std::min({k_maxSamplers, properties12.maxDescriptorSetUpdateAfterBindSamplers,
+                                          properties12.maxPerStageDescriptorUpdateAfterBindSamplers});
+
+    std::array<vk::DescriptorSetLayoutBinding, BindingCount> bindings;
+    std::array<vk::DescriptorBindingFlags, BindingCount> bindingFlags;
+    std::array<vk::DescriptorPoolSize, BindingCount> poolSizes;
+    for (uint32_t binding = 0; binding < BindingCount; binding++) {
+        vk::DescriptorType type = descriptorType(Binding(binding));
+        bindings[binding] = vk::DescriptorSetLayoutBinding(binding, type, arrays[binding].capacity, vk::ShaderStageFlagBits::eAll);
+        // Partially bound: slots that were never written are fine as long as no shader reads them
+        bindingFlags[binding] = vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                                vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending;
+        poolSizes[binding] = vk::DescriptorPoolSize(type, arrays[binding].capacity);
+    }
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.setBindingCount(BindingCount)
+        .setPBindingFlags(bindingFlags.data());
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.setPNext(&bindingFlagsInfo)
+        .setFlags(vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool)
+        .setBindingCount(BindingCount)
+        .setPBindings(bindings.data());
+    setLayout = device.createDescriptorSetLayout(layoutInfo);
+
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.setFlags(vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind)
+        .setMaxSets(1)
+        .setPoolSizeCount(BindingCount)
+        .setPPoolSizes(poolSizes.data());
+    pool = device.createDescriptorPool(poolInfo);
+    vk::DescriptorSetAllocateInfo allocInfo{};
+    allocInfo.setDescriptorPool(pool)
+        .setDescriptorSetCount(1)
+        .setPSetLayouts(&setLayout);
+    set = device.allocateDescriptorSets(allocInfo)[0];
+}
+
+void BindlessTable::destroy() {
+    if (!set) {
+        return;
+    }
+    device.destroyDescriptorPool(pool); // also frees the set
+    device.destroyDescriptorSetLayout(setLayout);
+    set = nullptr;
+    pool = nullptr;
+    setLayout = nullptr;
+    arrays = {};
+    pendingWrites.clear();
+    imageInfos.clear();
+    bufferInfos.clear();
+}
+
+vk::DescriptorType BindlessTable::descriptorType(Binding binding) {
+    switch (binding) {
+    case SampledImages:
+        return vk::DescriptorType::eSampledImage;
+    case StorageBuffers:
+        return vk::DescriptorType::eStorageBuffer;
+    case Samplers:
+        return vk::DescriptorType::eSampler;
+    default:
+        throw std::runtime_error("unknown bindless binding!");
+    }
+}
+
+BindlessTable::Handle BindlessTable::allocate(Binding binding) {
+    Array& array = arrays[binding];
+    if (!array.freeHandles.empty()) {
+        Handle handle = array.freeHandles.back();
+        array.freeHandles.pop_back();
+        return handle;
+    }
+    if (array.next == array.capacity) {
+        throw std::runtime_error("bindless table is full!");
+    }
+    return array.next++;
+}
+
+BindlessTable::Handle BindlessTable::addImage(vk::ImageView view, vk::ImageLayout layout) {
+    Handle handle = allocate(SampledImages);
+    pendingWrites.push_back({SampledImages, handle, static_cast<uint32_t>(imageInfos.size())});
+    imageInfos.push_back(vk::DescriptorImageInfo(nullptr, view, layout));
+    return handle;
+}
+
+BindlessTable::Handle BindlessTable::addBuffer(vk::Buffer buffer, vk::DeviceSize offset, vk::DeviceSize range) {
+    Handle handle = allocate(StorageBuffers);
+    pendingWrites.push_back({StorageBuffers, handle, static_cast<uint32_t>(bufferInfos.size())});
+    bufferInfos.push_back(vk::DescriptorBufferInfo(buffer, offset, range));
+    return handle;
+}
+
+BindlessTable::Handle BindlessTable::addSampler(vk::Sampler sampler) {
+    Handle handle = allocate(Samplers);
+    pendingWrites.push_back({Samplers, handle, static_cast<uint32_t>(imageInfos.size())});
+    imageInfos.push_back(vk::DescriptorImageInfo(sampler, nullptr, vk::ImageLayout::eUndefined));
+    return handle;
+}
+
+void BindlessTable::free(Binding binding, Handle handle) {
+    if (handle == k_invalidHandle) {
+        return;
+    }
+    // The frame being recorded may already reference the handle
+    arrays[binding].retired.push_back({framePacer->currentFrame(), handle});
+}
+
+void BindlessTable::flush() {
+    if (!set) {
+        return;
+    }
+    for (auto& array : arrays) {
+        while (!array.retired.empty() && framePacer->frameCompleted(array.retired.front().first)) {
+            array.freeHandles.push_back(array.retired.front().second);
+            array.retired.pop_front();
+        }
+    }
+    if (pendingWrites.empty()) {
+        return;
+    }
+    std::vector<vk::WriteDescriptorSet> writes;
+    writes.reserve(pendingWrites.size());
+    for (const auto& pending : pendingWrites) {
+        vk::WriteDescriptorSet write{};
+        write.setDstSet(set)
+            .setDstBinding(pending.binding)
+            .setDstArrayElement(pending.handle)
+            .setDescriptorCount(1)
+            .setDescriptorType(descriptorType(pending.binding));
+        if (pending.binding == StorageBuffers) {
+            write.setPBufferInfo(&bufferInfos[pending.info]);
+        } else {
+            write.setPImageInfo(&imageInfos[pending.info]);
+        }
+        writes.push_back(write);
+    }
+    device.updateDescriptorSets(static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    pendingWrites.clear();
+    imageInfos.clear();
+    bufferInfos.clear();
+}
+
+void BindlessTable::bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout,
+                         uint32_t setIndex) const {
+    commandBuffer.bindDescriptorSets(bindPoint, pipelineLayout, setIndex, 1, &set, 0, nullptr);
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "vulkan_common.hpp"
+#include "frame_pacer.hpp"
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Global bindless resource table: a single descriptor set holding large, partially bound arrays of sampled
+// images, storage buffers and samplers. It is bound once per command buffer and shaders index the arrays with
+// 32-bit handles passed in push constants, so nothing is bound per draw.
+//
+// The bindings are update-after-bind and update-unused-while-pending: descriptors are written into the set
+// while frames in flight keep using it, as long as those frames do not use the written slots. Handles are
+// therefore only recycled once every frame submitted before the free has completed.
+//
+// Shader side (set 0):
+//   layout(set = 0, binding = 0) uniform texture2D images[];
+//   layout(set = 0, binding = 1) buffer Buffer { ... } buffers[];
+//   layout(set = 0, binding = 2) uniform sampler samplers[];
+class BindlessTable {
+public:
+    using Handle = uint32_t;
+    static constexpr Handle k_invalidHandle = UINT32_MAX;
+
+    enum Binding : uint32_t {
+        SampledImages = 0,
+        StorageBuffers = 1,
+        Samplers = 2,
+        BindingCount,
+    };
+    // Upper bounds, clamped to the update-after-bind limits of the device
+    static constexpr uint32_t k_maxSampledImages = 1u << 16;
+    static constexpr uint32_t k_maxStorageBuffers = 1u << 16;
+    static constexpr uint32_t k_maxSamplers = 1u << 10;
+
+    // Turns on the descriptor indexing features the table needs, returns false (changing nothing) when one is missing
+    static bool enableFeatures(const vk::PhysicalDeviceVulkan12Features& supported, vk::PhysicalDeviceVulkan12Features& enabled);
+
+    void init(vk::PhysicalDevice physicalDevice, vk::Device device, FramePacer& framePacer);
+    void destroy();
+    bool isValid() const { return static_cast<bool>(set); }
+
+    vk::DescriptorSetLayout layout() const { return setLayout; }
+    uint32_t capacity(Binding binding) const { return arrays[binding].capacity; }
+
+    // O(1), the descriptor itself is written by the next flush()
+    Handle addImage(vk::ImageView view, vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+    Handle addBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+    Handle addSampler(vk::Sampler sampler);
+    // O(1), the handle is handed out again once the frames submitted so far have completed
+    void free(Binding binding, Handle handle);
+
+    // Once per frame before recording: writes every descriptor added since the last call with a single
+    // vkUpdateDescriptorSets and recycles the handles whose frames have completed
+    void flush();
+    void bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout, uint32_t setIndex = 0) const;
+
+private:
+    struct Array {
+        uint32_t capacity = 0;
+        uint32_t next = 0;                                 // handles below next have been handed out at least once
+        std::vector<Handle> freeHandles;
+        std::deque<std::pair<uint64_t, Handle>> retired;   // last frame that may use it, handle
+    };
+    struct PendingWrite {
+        Binding binding;
+        Handle handle;
+        uint32_t info; // index into imageInfos or bufferInfos
+    };
+
+    Handle allocate(Binding binding);
+    static vk::DescriptorType descriptorType(Binding binding);
+
+    vk::Device device;
+    FramePacer* framePacer = nullptr;
+    vk::DescriptorSetLayout setLayout;
+    vk::DescriptorPool pool;
+    vk::DescriptorSet set;
+    std::array<Array, BindingCount> arrays;
+
+    std::vector<PendingWrite> pendingWrites;
+    std::vector<vk::DescriptorImageInfo> imageInfos;
+    std::vector<vk::DescriptorBufferInfo> bufferInfos;
+};
@@ -0,0 +1,68 @@
+#include "camera.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+void multiply(const float a[16], const float b[16], float out[16]) {
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a[k * 4 + row] * b[column * 4 + k];
+            }
+            out[column * 4 + row] = sum;
+        }
+    }
+}
+
+void lookAt(const float eye[3], const float center[3], float out[16]) {
+    float f[3] = {center[0] - eye[0], center[1] - eye[1], center[2] - eye[2]};
+    float length = std::sqrt(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+    for (auto& v : f) {
+        v /= length;
+    }
+    // side = f x up with up = +Y
+    float s[3] = {-f[2], 0.0f, f[0]};
+    length = std::sqrt(s[0] * s[0] + s[2] * s[2]);
+    s[0] /= length;
+    s[2] /= length;
+    float u[3] = {s[1] * f[2] - s[2] * f[1], s[2] * f[0] - s[0] * f[2], s[0] * f[1] - s[1] * f[0]};
+    float matrix[16] = {
+        s[0], u[0], -f[0], 0.0f,
+        s[1], u[1], -f[1], 0.0f,
+        s[2], u[2], -f[2], 0.0f,
+        -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]),
+        -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]),
+        f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2], 1.0f,
+    };
+    std::copy(matrix, matrix + 16, out);
+}
+
+void perspective(float fovY, float aspect, float zNear, float zFar, float out[16]) {
+    float t = 1.0f / std::tan(fovY / 2.0f);
+    std::fill(out, out + 16, 0.0f);
+    out[0] = t / aspect;
+    out[5] = -t;
+    out[10] = zFar / (zNear - zFar);
+    out[11] = -1.0f;
+    out[14] = zNear * zFar / (zNear - zFar);
+}
+
+void frustumPlanes(const float m[16], float planes[6][4]) {
+    auto row = [&](int r, int c) { return m[c * 4 + r]; };
+    for (int i = 0; i < 6; i++) {
+        int axis = i / 2;
+        float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+        for (int c = 0; c < 4; c++) {
+            if (axis < 2) {
+                planes[i][c] = row(3, c) + sign * row(axis, c); // left/right, bottom/top
+            } else {
+                planes[i][c] = i == 4 ? row(2, c) : row(3, c) - row(2, c); // near (z >= 0), far (z <= w)
+            }
+        }
+        float length = std::sqrt(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        for (float& v : planes[i]) {
+            v /= length;
+        }
+    }
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+// Column-major 4x4 matrices, matching GLSL
+void multiply(const float a[16], const float b[16], float out[16]);
+// View matrix looking from eye at center, with +Y up
+void lookAt(const float eye[3], const float center[3], float out[16]);
+// Right-handed, depth in [0, 1] and Y pointing down in clip space as Vulkan expects
+void perspective(float fovY, float aspect, float zNear, float zFar, float out[16]);
+// Gribb/Hartmann plane extraction, normalized so plane distances are in world units
+void frustumPlanes(const float m[16], float planes[6][4]);
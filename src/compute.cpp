@@ -0,0 +1,102 @@
+#include "compute.hpp"
+
+#include <stdexcept>
+
+void ComputePipeline::create(vk::Device device, vk::ShaderModule shader, const std::vector<vk::DescriptorSetLayout>& setLayouts,
+                             uint32_t pushConstantSize, vk::PipelineCache pipelineCache) {
+    this->device = device;
+    vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eCompute, 0, pushConstantSize);
+    vk::PipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.setSetLayoutCount(static_cast<uint32_t>(setLayouts.size()))
+        .setPSetLayouts(setLayouts.data())
+        .setPushConstantRangeCount(pushConstantSize > 0 ? 1 : 0)
+        .setPPushConstantRanges(&pushConstantRange);
+    pipelineLayout = device.createPipelineLayout(layoutInfo);
+
+    vk::PipelineShaderStageCreateInfo stageInfo{};
+    stageInfo.setStage(vk::ShaderStageFlagBits::eCompute)
+        .setModule(shader)
+        .setPName("main");
+    vk::ComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.setStage(stageInfo)
+        .setLayout(pipelineLayout);
+    if (device.createComputePipelines(pipelineCache, 1, &pipelineInfo, nullptr, &handle) != vk::Result::eSuccess) {
+        throw std::runtime_error("failed to create compute pipeline!");
+    }
+}
+
+void ComputePipeline::destroy() {
+    if (handle) {
+        device.destroyPipeline(handle);
+        device.destroyPipelineLayout(pipelineLayout);
+        handle = nullptr;
+        pipelineLayout = nullptr;
+    }
+}
+
+void ComputePipeline::bind(vk::CommandBuffer commandBuffer, vk::DescriptorSet descriptorSet) const {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, handle);
+    if (descriptorSet) {
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    }
+}
+
+void ComputePipeline::pushConstants(vk::CommandBuffer commandBuffer, const void* data, uint32_t size) const {
+    commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, size, data);
+}
+
+void AsyncCompute::init(vk::Device device, uint32_t queueFamily, vk::Queue queue, uint32_t frameSlots, std::mutex* queueMutex) {
+    this->device = device;
+    this->queueFamily = queueFamily;
+    this->queue = queue;
+    this->queueMutex = queueMutex;
+    pools.resize(frameSlots);
+    commandBuffers.resize(frameSlots);
+    finishedSemaphores.resize(frameSlots);
+    for (uint32_t slot = 0; slot < frameSlots; slot++) {
+        vk::CommandPoolCreateInfo poolInfo{};
+        poolInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+            .setQueueFamilyIndex(queueFamily);
+        pools[slot] = device.createCommandPool(poolInfo);
+        vk::CommandBufferAllocateInfo allocInfo{};
+        allocInfo.setCommandPool(pools[slot])
+            .setLevel(vk::CommandBufferLevel::ePrimary)
+            .setCommandBufferCount(1);
+        commandBuffers[slot] = device.allocateCommandBuffers(allocInfo)[0];
+        finishedSemaphores[slot] = device.createSemaphore(vk::SemaphoreCreateInfo());
+    }
+}
+
+void AsyncCompute::destroy() {
+    for (auto pool : pools) {
+        device.destroyCommandPool(pool);
+    }
+    for (auto semaphore : finishedSemaphores) {
+        device.destroySemaphore(semaphore);
+    }
+    pools.clear();
+    commandBuffers.clear();
+    finishedSemaphores.clear();
+}
+
+vk::CommandBuffer AsyncCompute::begin(uint32_t slot) {
+    device.resetCommandPool(pools[slot], {});
+    commandBuffers[slot].begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+    return commandBuffers[slot];
+}
+
+vk::Semaphore AsyncCompute::submit(uint32_t slot) {
+    commandBuffers[slot].end();
+    vk::SubmitInfo submitInfo{};
+    submitInfo.setCommandBufferCount(1)
+        .setPCommandBuffers(&commandBuffers[slot])
+        .setSignalSemaphoreCount(1)
+        .setPSignalSemaphores(&finishedSemaphores[slot]);
+    // No fence needed: the graphics frame waits on the semaphore, so its completion implies this submission's
+    std::unique_lock<std::mutex> lock;
+    if (queueMutex) {
+        lock = std::unique_lock<std::mutex>(*queueMutex);
+    }
+    queue.submit(1, &submitInfo, nullptr);
+    return finishedSemaphores[slot];
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include "vulkan_common.hpp"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// A compute shader together with the pipeline layout it was built against
+class ComputePipeline {
+public:
+    void create(vk::Device device, vk::ShaderModule shader, const std::vector<vk::DescriptorSetLayout>& setLayouts,
+                uint32_t pushConstantSize, vk::PipelineCache pipelineCache);
+    void destroy();
+
+    vk::Pipeline pipeline() const { return handle; }
+    vk::PipelineLayout layout() const { return pipelineLayout; }
+
+    void bind(vk::CommandBuffer commandBuffer, vk::DescriptorSet descriptorSet) const;
+    void pushConstants(vk::CommandBuffer commandBuffer, const void* data, uint32_t size) const;
+    // Workgroups needed to cover itemCount invocations
+    static uint32_t groupCount(uint32_t itemCount, uint32_t groupSize) { return (itemCount + groupSize - 1) / groupSize; }
+
+private:
+    vk::Device device;
+    vk::PipelineLayout pipelineLayout;
+    vk::Pipeline handle;
+};
+
+// Per-frame command buffers on the compute queue. Compute work for a frame is submitted right before the
+// graphics work of that frame and signals a semaphore the graphics submission waits on, so it overlaps with
+// the rasterization of the previous frame instead of running serially in the graphics queue.
+//
+// Resources shared with graphics are expected to use VK_SHARING_MODE_CONCURRENT when the families differ,
+// which avoids per-frame queue family ownership transfers.
+class AsyncCompute {
+public:
+    // queueMutex guards the compute queue when it is shared with another submitting subsystem
+    void init(vk::Device device, uint32_t queueFamily, vk::Queue queue, uint32_t frameSlots, std::mutex* queueMutex);
+    void destroy();
+
+    uint32_t family() const { return queueFamily; }
+
+    // Resets the slot's commands and starts recording, only call once the frame that last used the slot completed
+    vk::CommandBuffer begin(uint32_t slot);
+    // Ends and submits the slot's commands. Returns the semaphore the frame's graphics submission has to wait on.
+    vk::Semaphore submit(uint32_t slot);
+
+private:
+    vk::Device device;
+    uint32_t queueFamily = 0;
+    vk::Queue queue;
+    std::mutex* queueMutex = nullptr;
+    std::vector<vk::CommandPool> pools;
+    std::vector<vk::CommandBuffer> commandBuffers;
+    std::vector<vk::Semaphore> finishedSemaphores;
+};
@@ -0,0 +1,100 @@
+#include "file_watcher.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#ifdef __linux__
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+void FileWatcher::start(const std::string& directory) {
+    stop();
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        throw std::runtime_error("failed to initialize inotify!");
+    }
+    // Compilers either write the file in place (close after write) or rename a temporary over it
+    if (inotify_add_watch(inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+        throw std::runtime_error("failed to watch " + directory + "!");
+    }
+    this->directory = directory;
+#else
+    if (!std::filesystem::is_directory(directory)) {
+        throw std::runtime_error("failed to watch " + directory + "!");
+    }
+    modificationTimes.clear();
+    this->directory = directory;
+    scan(nullptr);
+    lastPoll = std::chrono::steady_clock::now();
+#endif
+}
+
+void FileWatcher::stop() {
+#ifdef __linux__
+    if (inotifyFd >= 0) {
+        close(inotifyFd);
+        inotifyFd = -1;
+    }
+#else
+    modificationTimes.clear();
+#endif
+    directory.clear();
+}
+
+std::vector<std::string> FileWatcher::changes() {
+    std::vector<std::string> changed;
+    if (directory.empty()) {
+        return changed;
+    }
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    for (;;) {
+        ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break; // EAGAIN: nothing left to read
+        }
+        for (ssize_t offset = 0; offset < length;) {
+            auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && !(event->mask & IN_ISDIR)) {
+                changed.emplace_back(event->name);
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+#else
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll < k_pollInterval) {
+        return changed;
+    }
+    lastPoll = now;
+    scan(&changed);
+#endif
+    // One save can produce several events for the same file
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+#ifndef __linux__
+void FileWatcher::scan(std::vector<std::string>* changed) {
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (!entry.is_regular_file(error)) {
+            continue;
+        }
+        auto time = entry.last_write_time(error);
+        auto name = entry.path().filename().string();
+        auto found = modificationTimes.find(name);
+        if (found == modificationTimes.end() || found->second != time) {
+            modificationTimes[name] = time;
+            if (changed) {
+                changed->push_back(name);
+            }
+        }
+    }
+}
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+
+// Reports files that were rewritten in a directory, for development tools such as shader hot reload.
+// Linux gets the events from inotify. Elsewhere the modification times are compared, at most every
+// k_pollInterval so calling changes() every frame stays cheap.
+class FileWatcher {
+public:
+    static constexpr std::chrono::milliseconds k_pollInterval{500};
+
+    // Throws if the directory cannot be watched
+    void start(const std::string& directory);
+    void stop();
+    bool isWatching() const { return !directory.empty(); }
+
+    // Never blocks: names, relative to the directory, of the files written since the previous call
+    std::vector<std::string> changes();
+
+private:
+    std::string directory;
+#ifdef __linux__
+    int inotifyFd = -1;
+#else
+    std::map<std::string, std::filesystem::file_time_type> modificationTimes;
+    std::chrono::steady_clock::time_point lastPoll;
+    void scan(std::vector<std::string>* changed);
+#endif
+};
@@ -0,0 +1,119 @@
+#include "frame_pacer.hpp"
+
+#include <algorithm>
+
+void FramePacer::init(vk::Device device, uint32_t framesInFlight, bool useTimeline) {
+    this->device = device;
+    this->framesInFlight = std::clamp(framesInFlight, k_minFramesInFlight, k_maxFramesInFlight);
+    submittedFrame = 0;
+    completedFrame = 0;
+
+    if (useTimeline) {
+        vk::SemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.setSemaphoreType(vk::SemaphoreType::eTimeline)
+            .setInitialValue(0);
+        vk::SemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.setPNext(&typeInfo);
+        timeline = device.createSemaphore(semaphoreInfo);
+    } else {
+        vk::FenceCreateInfo fenceInfo{};
+        fenceInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
+        fences.resize(this->framesInFlight);
+        for (auto& fence : fences) {
+            fence = device.createFence(fenceInfo);
+        }
+        slotFrames.assign(this->framesInFlight, 0);
+    }
+}
+
+void FramePacer::destroy() {
+    if (timeline) {
+        device.destroySemaphore(timeline);
+        timeline = nullptr;
+    }
+    for (auto fence : fences) {
+        device.destroyFence(fence);
+    }
+    fences.clear();
+    slotFrames.clear();
+}
+
+uint32_t FramePacer::beginFrame() {
+    // The slot is reused from the frame that was submitted framesInFlight frames ago
+    if (currentFrame() > framesInFlight) {
+        waitForFrame(currentFrame() - framesInFlight);
+    }
+    return currentSlot();
+}
+
+void FramePacer::submit(vk::Queue queue, const vk::SubmitInfo& submitInfo) {
+    uint64_t frame = currentFrame();
+    if (timeline) {
+        // Binary semaphores ignore their value, but the value array has to cover every signaled semaphore
+        std::vector<vk::Semaphore> signalSemaphores(submitInfo.pSignalSemaphores,
+                                                    submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+        signalSemaphores.push_back(timeline);
+        std::vector<uint64_t> signalValues(signalSemaphores.size(), 0);
+        signalValues.back() = frame;
+
+        vk::TimelineSemaphoreSubmitInfo timelineInfo{};
+        timelineInfo.setPNext(submitInfo.pNext)
+            .setSignalSemaphoreValueCount(static_cast<uint32_t>(signalValues.size()))
+            .setPSignalSemaphoreValues(signalValues.data());
+        vk::SubmitInfo timelineSubmit = submitInfo;
+        timelineSubmit.setPNext(&timelineInfo)
+            .setSignalSemaphoreCount(static_cast<uint32_t>(signalSemaphores.size()))
+            .setPSignalSemaphores(signalSemaphores.data());
+        queue.submit(1, &timelineSubmit, nullptr);
+    } else {
+        uint32_t slot = currentSlot();
+        // Only reset right before the submit, an early return between beginFrame and submit must leave the fence signaled
+        device.resetFences(1, &fences[slot]);
+        queue.submit(1, &submitInfo, fences[slot]);
+        slotFrames[slot] = frame;
+    }
+    submittedFrame = frame;
+}
+
+bool FramePacer::frameCompleted(uint64_t frame) {
+    if (frame <= completedFrame) {
+        return true;
+    }
+    if (frame > submittedFrame) {
+        return false;
+    }
+    if (timeline) {
+        completedFrame = std::max(completedFrame, device.getSemaphoreCounterValue(timeline));
+        return frame <= completedFrame;
+    }
+    uint32_t slot = static_cast<uint32_t>((frame - 1) % framesInFlight);
+    // A newer frame reusing the slot implies this one finished before it was recycled
+    if (slotFrames[slot] > frame) {
+        return true;
+    }
+    if (device.getFenceStatus(fences[slot]) == vk::Result::eSuccess) {
+        completedFrame = std::max(completedFrame, slotFrames[slot]);
+        return true;
+    }
+    return false;
+}
+
+void FramePacer::waitForFrame(uint64_t frame) {
+    if (frame <= completedFrame || frame > submittedFrame) {
+        return;
+    }
+    if (timeline) {
+        vk::SemaphoreWaitInfo waitInfo{};
+        waitInfo.setSemaphoreCount(1)
+            .setPSemaphores(&timeline)
+            .setPValues(&frame);
+        (void)device.waitSemaphores(waitInfo, UINT64_MAX);
+        completedFrame = std::max(completedFrame, frame);
+        return;
+    }
+    uint32_t slot = static_cast<uint32_t>((frame - 1) % framesInFlight);
+    if (slotFrames[slot] == frame) {
+        (void)device.waitForFences(1, &fences[slot], true, UINT64_MAX);
+    }
+    completedFrame = std::max(completedFrame, frame);
+}
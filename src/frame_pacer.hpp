@@ -0,0 +1,47 @@
+#pragma once
+#include "vulkan_common.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Paces the CPU against the GPU with a runtime-configurable number of frames in flight.
+// Every submitted frame gets a serial number (starting at 1). With timeline semaphores a single
+// semaphore is signaled with that serial, otherwise one fence per frame slot is used instead.
+// Other subsystems can use frameCompleted()/waitForFrame() to defer work until the GPU is done with a frame.
+class FramePacer {
+public:
+    static constexpr uint32_t k_minFramesInFlight = 1;
+    static constexpr uint32_t k_maxFramesInFlight = 4;
+
+    void init(vk::Device device, uint32_t framesInFlight, bool useTimeline);
+    void destroy();
+
+    uint32_t depth() const { return framesInFlight; }
+    bool usesTimeline() const { return static_cast<bool>(timeline); }
+
+    // Blocks until the slot of the next frame is no longer used by the GPU and returns that slot.
+    // Calling it again without a submit in between returns the same frame.
+    uint32_t beginFrame();
+    // Serial of the frame being recorded, i.e. the one the next submit() will signal
+    uint64_t currentFrame() const { return submittedFrame + 1; }
+    uint32_t currentSlot() const { return static_cast<uint32_t>(submittedFrame % framesInFlight); }
+    uint64_t lastSubmittedFrame() const { return submittedFrame; }
+
+    // Submits the current frame, adding the timeline signal (or fence) that marks its completion.
+    void submit(vk::Queue queue, const vk::SubmitInfo& submitInfo);
+
+    // Non-blocking check, frames that were never submitted are not completed
+    bool frameCompleted(uint64_t frame);
+    void waitForFrame(uint64_t frame);
+
+private:
+    vk::Device device;
+    uint32_t framesInFlight = 2;
+    uint64_t submittedFrame = 0;
+    uint64_t completedFrame = 0;
+
+    vk::Semaphore timeline;
+    // Fence fallback, used when timeline semaphores are not available
+    std::vector<vk::Fence> fences;
+    std::vector<uint64_t> slotFrames;
+};
@@ -1,16 +1,30 @@
-#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
-#define NOMINMAX
-#ifdef __ANDROID__
-#include <android/asset_manager.h>
-#include <jni.h>
-#include <android/asset_manager_jni.h>
-#include "vulkan-wrapper-patch.h"
-#include <vulkan_wrapper.h>
-#undef VK_NO_PROTOTYPES
-#endif
-#include <vulkan/vulkan.hpp>
+#include "vulkan_common.hpp"
+#include "pipeline_cache.hpp"
+#include "thread_pool.hpp"
+#include "frame_pacer.hpp"
+#include "profiler.hpp"
+#include "memory_allocator.hpp"
+#include "upload_manager.hpp"
+#include "compute.hpp"
+#include "pipelines.hpp"
+#include "pipeline_builder.hpp"
+#include "pipeline_registry.hpp"
+#include "render_graph.hpp"
+#include "bindless_table.hpp"
+#include "uniform_ring.hpp"
+#include "present_policy.hpp"
+#include "spsc_queue.hpp"
+#include "startup_profiler.hpp"
+#include "scene.hpp"
+#include "asset_store.hpp"
+#include "mesh_file.hpp"
+#include "file_watcher.hpp"
+#include "camera.hpp"
 #include "SDL.h"
 #include <SDL_vulkan.h>
+#ifdef NARU_EMBED_SHADERS
+#include "embedded_shaders.hpp"
+#endif
 
 #include <algorithm>
 #include <iostream>
@@ -19,8 +33,25 @@
 #include <cstdlib>
 #include <optional>
 #include <set>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <deque>
+#include <array>
 #include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <span>
+#include <filesystem>
+#include <future>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
 #ifdef _WIN32
 #include <Windows.h>
 #include <mutex>
@@ -36,7 +67,11 @@ VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
 static constexpr int k_width = 800;
 static constexpr int k_height = 600;
-const int MAX_FRAMES_IN_FLIGHT = 2;
+// Below this many draws per secondary command buffer, spreading the recording across threads costs more than it saves
+static constexpr uint32_t k_minDrawsPerThread = 256;
+// How long an idle on-demand loop sleeps between checks for content that arrives without an event
+// (pipelines, streamed meshes, shader hot reload)
+static constexpr int k_idleTimeoutMs = 100;
 
 #define LOG(x) std::cout << x << std::endl;
 
@@ -61,20 +96,96 @@ const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
+struct AppOptions {
+    // Render into a device-local image instead of a swapchain, with no window or surface.
+    bool headless = false;
+    vk::Extent2D headlessExtent{k_width, k_height};
+    // Number of frames to render before exiting in headless mode.
+    uint32_t frameCount = 1000;
+    // When set, the last headless frame is read back and written to this path as a binary PPM.
+    std::string dumpPath;
+    // Number of draws recorded per frame, used to stress command recording.
+    uint32_t drawCount = 1;
+    // When non-zero, renders the GPU-driven benchmark scene with this many instances instead of the triangles.
+    uint32_t instanceCount = 0;
+    // .nmesh file rendered instead of the triangles, streamed in on a loader thread
+    std::string meshPath;
+    // Rebuilds the graphics pipelines in the background whenever their SPIR-V is rewritten
+    bool hotReload = false;
+    // Threads recording secondary command buffers, including the render thread.
+    uint32_t recordingThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    // How many frames the CPU may run ahead of the GPU (1 for lowest latency, 3 for throughput), 0 leaves it to the present policy.
+    uint32_t framesInFlight = 0;
+    // Present mode, swapchain length and frame pacing, see PresentPolicy
+    PresentPolicy presentPolicy = PresentPolicy::Default;
+    // Only redraws when input, a resize or newly loaded content changes the frame, sleeping in between.
+    bool onDemand = false;
+    // Frame limiter target, 0 for no limit. The power-save policy defaults to FrameLimiter::k_powerSaveFps.
+    double targetFps = 0.0;
+    // Samples per pixel of the main pass (1, 2, 4 or 8), lowered to what the device supports. M cycles it at runtime.
+    uint32_t msaaSamples = 1;
+    // Profiling output, the profiler only runs when at least one of them is set.
+    std::string tracePath;
+    std::string profileCsvPath;
+    // JSON report of the startup phases, see StartupProfiler
+    std::string startupReportPath;
+};
+
 class HelloTriangleApplication {
 public:
+    explicit HelloTriangleApplication(const AppOptions& options = {})
+        : options(options), workers(std::make_unique<ThreadPool>(options.recordingThreads - 1)) {
+        profiler.setEnabled(!options.tracePath.empty() || !options.profileCsvPath.empty());
+        frameLimiter.setTargetFps(options.targetFps);
+    }
+
     void run() {
+        startup.begin();
 #ifdef DEBUG
         std::cout << "DEBUG BUILD" << std::endl;
 #endif
-        initWindow();
+        if (!options.headless) {
+            startup.measure("sdl init", [&] { initSdl(); });
+        }
+        // The instance only needs the extension list from SDL, it is created on a worker while the window opens
+        auto instanceExtensions = getRequiredExtensions();
+        auto instanceCreation = std::async(std::launch::async, [this, instanceExtensions] {
+            startup.measure("create instance", [&] {
+                createInstance(instanceExtensions);
+#ifdef DEBUG
+                setupDebugMessenger();
+#endif
+            });
+        });
+        if (!options.headless) {
+            startup.measure("create window", [&] { initWindow(); });
+        }
+        startup.measure("init assets", [&] {
+            initAssets();
+            resolvePipelineCacheDirectory();
+        });
+        instanceCreation.get(); // rethrows what the worker threw
         initVulkan();
-        mainLoop();
+        startShaderWatcher();
+        startup.finish();
+        startup.printSummary(std::cout);
+        if (!options.startupReportPath.empty()) {
+            startup.writeJson(options.startupReportPath);
+            std::cout << "Wrote startup report to " << options.startupReportPath << std::endl;
+        }
+        if (options.headless) {
+            headlessLoop();
+        } else {
+            mainLoop();
+        }
+        writeProfile();
         cleanup();
     }
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily; // transfer-only family, usually a dedicated DMA engine
+        std::optional<uint32_t> computeFamily;  // preferably without graphics, so compute runs next to rasterization
 
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -89,6 +200,15 @@ public:
         for (const auto& queueFamily : queueFamilies) {
             if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) {
                 indices.graphicsFamily = index;
+                // Without a surface nothing is ever presented, the graphics queue stands in for the present queue
+                if (options.headless) {
+                    indices.presentFamily = index;
+                    break;
+                }
+            }
+            if (options.headless) {
+                index++;
+                continue;
             }
             vk::Bool32 presentSupport = device.getSurfaceSupportKHR(index, surface);
             if (presentSupport) {
@@ -99,6 +219,25 @@ public:
             }
             index++;
         }
+        // Copies on a transfer-only family run next to rendering instead of interleaving with it
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            auto flags = queueFamilies[i].queueFlags;
+            if ((flags & vk::QueueFlagBits::eTransfer) && !(flags & (vk::QueueFlagBits::eGraphics | vk::QueueFlagBits::eCompute))) {
+                indices.transferFamily = i;
+                break;
+            }
+        }
+        for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+            auto flags = queueFamilies[i].queueFlags;
+            if ((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+                indices.computeFamily = i;
+                break;
+            }
+        }
+        if (!indices.computeFamily && indices.graphicsFamily
+            && (queueFamilies[indices.graphicsFamily.value()].queueFlags & vk::QueueFlagBits::eCompute)) {
+            indices.computeFamily = indices.graphicsFamily;
+        }
         return indices;
     }
 
@@ -122,13 +261,22 @@ public:
     }
 
     bool isDeviceSuitable(vk::PhysicalDevice device) {
+        if (options.headless) {
+            return findQueueFamilies(device).isComplete();
+        }
         // Note: only check for swap chain support after verifying that the extension is avaible, therefore order must be kept
         return findQueueFamilies(device).isComplete() && checkDeviceExtensionSupport(device) && isSwapChainSupportSufficient(device);
     }
 
+    std::vector<const char*> getDeviceExtensions() const {
+        // No surface means no swapchain, so headless mode does not need any device extension
+        return options.headless ? std::vector<const char*>{} : deviceExtensions;
+    }
+
     bool checkDeviceExtensionSupport(vk::PhysicalDevice device) {
         auto availableExtensions = device.enumerateDeviceExtensionProperties();
-        std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
+        auto extensions = getDeviceExtensions();
+        std::set<std::string> requiredExtensions(extensions.begin(), extensions.end());
         for (const auto& extension : availableExtensions) {
             requiredExtensions.erase(extension.extensionName);
         }
@@ -150,21 +298,15 @@ public:
 
     vk::PresentModeKHR chooseSwapPresentMode(const std::vector<vk::PresentModeKHR>& availablePresentModes)
     {
-        for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == vk::PresentModeKHR::eMailbox) {
-                return availablePresentMode;
-            }
-        }
-        return vk::PresentModeKHR::eFifo;
+        return choosePresentMode(options.presentPolicy, availablePresentModes);
     }
 
     vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities) {
         if (capabilities.currentExtent.width != UINT32_MAX) {
             return capabilities.currentExtent;
         } else {
-            int width, height;
-            SDL_GetWindowSize(window, &width, &height);
-            vk::Extent2D actualExtent = {(uint32_t)width, (uint32_t)height};
+            // Kept up to date by the resize messages, SDL is only queried on the event thread
+            vk::Extent2D actualExtent = windowExtent;
             actualExtent.width = std::clamp(actualExtent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
             actualExtent.height = std::clamp(actualExtent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
             return actualExtent;
@@ -194,28 +336,66 @@ public:
 #endif
 
 private:
+    struct FrameCommands {
+        std::vector<vk::CommandPool> pools;             // one per recording thread
+        std::vector<vk::CommandBuffer> secondaries;     // one per pool
+        vk::CommandBuffer primary;                      // allocated from pools[0]
+        uint32_t secondaryCount = 0;                    // secondaries recorded for the current frame
+        // Transfer batches acquired by this frame, the submit waits on them
+        std::vector<vk::Semaphore> uploadWaits;
+        std::vector<vk::PipelineStageFlags> uploadWaitStages;
+    };
+
+    // Everything after the instance, each group of steps is a startup phase
     void initVulkan() {
-#ifdef __ANDROID__
-        // Try to dynamically load the Vulkan library and seed the function pointer mapping.
-        if (!InitVulkan()) {
-            return;
+        if (!options.headless) {
+            startup.measure("create surface", [&] { createSurface(); });
         }
-#endif
-        createInstance();
-#ifdef DEBUG
-        setupDebugMessenger();
-#endif
-        createSurface();
-        pickPhysicalDevice();
-        createLogicalDevice();
-        createSwapChain();
-        createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
-        createFramebuffers();
-        createCommandPool();
-        createCommandBuffers();
-        createSyncObjects();
+        // Shader files are read on a worker while the device is created, loadShader() then finds them in memory
+        auto shaderPreload = std::async(std::launch::async, [this] {
+            startup.measure("preload shaders", [&] { preloadShaders(); });
+        });
+        startup.measure("create device", [&] {
+            pickPhysicalDevice();
+            createLogicalDevice();
+            allocator.init(physicalDevice, device);
+            createBindlessTable();
+        });
+        shaderPreload.get();
+        startup.measure("load pipeline cache", [&] { loadPipelineCache(); });
+        startup.measure("open mesh", [&] { openMesh(); });
+        startup.measure("create swapchain", [&] {
+            if (options.headless) {
+                createOffscreenTarget();
+            } else {
+                createSwapChain();
+            }
+            createImageViews();
+        });
+        startup.measure("create render graph", [&] { createRenderGraph(); });
+        startup.measure("request pipelines", [&] {
+            createSimulationLayout();
+            createSceneLayout();
+            uniformRing.createSetLayout(device);
+            createGraphicsPipeline();
+        });
+        startup.measure("create attachments", [&] { createGraphAttachments(); });
+        startup.measure("create frame resources", [&] {
+            createCommandPool();
+            createFramePacer();
+            createUploadManager();
+            createUniformRing();
+        });
+        startup.measure("create simulation", [&] { createSimulation(); });
+        startup.measure("create scene", [&] {
+            createScene();
+            createMesh();
+        });
+        startup.measure("create frame commands", [&] {
+            profiler.initGpu(device, physicalDevice, findQueueFamilies(physicalDevice).graphicsFamily.value(), framePacer.depth());
+            createFrameCommands();
+            createSyncObjects();
+        });
     }
 
     void createSurface() {
@@ -228,6 +408,17 @@ private:
         surface = vk::SurfaceKHR(temporarySurface);
     }
 
+    // Looked up once on the main thread, a device reset reloads the cache on the render thread without asking SDL again
+    void resolvePipelineCacheDirectory() {
+        if (!pipelineCacheDirectory.empty()) {
+            return;
+        }
+        if (char* prefPath = SDL_GetPrefPath("Naru", "Naru")) {
+            pipelineCacheDirectory = prefPath;
+            SDL_free(prefPath);
+        }
+    }
+
     void pickPhysicalDevice() {
         auto devices = instance.enumeratePhysicalDevices();
         int bestScore = 0;
@@ -250,16 +441,77 @@ private:
 
     void createLogicalDevice() {
         QueueFamilyIndices indices = findQueueFamilies(physicalDevice);
+        uint32_t graphicsFamily = indices.graphicsFamily.value();
+        // Each role gets its own queue while its family has enough of them, later roles share the family's last queue.
+        // Without dedicated families, compute and uploads thereby end up on extra graphics queues when there are any.
+        auto queueFamilies = physicalDevice.getQueueFamilyProperties();
+        std::map<uint32_t, uint32_t> queueCounts;
+        auto requestQueue = [&](uint32_t family) {
+            uint32_t index = std::min(queueCounts[family], queueFamilies[family].queueCount - 1);
+            queueCounts[family] = std::max(queueCounts[family], index + 1);
+            return index;
+        };
+        uint32_t graphicsQueueIndex = requestQueue(graphicsFamily);
+        uint32_t presentQueueIndex = indices.presentFamily == graphicsFamily ? graphicsQueueIndex : requestQueue(indices.presentFamily.value());
+        uint32_t computeQueueIndex = requestQueue(indices.computeFamily.value());
+        uint32_t transferQueueIndex = requestQueue(indices.transferFamily.value_or(graphicsFamily));
+
         std::vector<vk::DeviceQueueCreateInfo> queueCreateInfos;
-        std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
-        float queuePriority = 1.0f;
-        for (uint32_t queueFamilyIndex : uniqueQueueFamilies) {
-            vk::DeviceQueueCreateInfo queueCreateInfo({}, queueFamilyIndex, 1, &queuePriority);
+        std::vector<float> queuePriorities(4, 1.0f);
+        for (auto [queueFamilyIndex, queueCount] : queueCounts) {
+            vk::DeviceQueueCreateInfo queueCreateInfo({}, queueFamilyIndex, queueCount, queuePriorities.data());
             queueCreateInfos.push_back(queueCreateInfo);
         }
-        vk::PhysicalDeviceFeatures deviceFeatures{};
+        // Multi-draw indirect lets the instanced scene issue all of its meshes with one command
+        auto supportedFeatures = physicalDevice.getFeatures();
+        enabledFeatures = vk::PhysicalDeviceFeatures{};
+        enabledFeatures.setMultiDrawIndirect(supportedFeatures.multiDrawIndirect)
+            .setDrawIndirectFirstInstance(supportedFeatures.drawIndirectFirstInstance);
+
+        // Vulkan 1.2 features can only be queried and enabled when both the instance and the device speak 1.2
+        vk::PhysicalDeviceVulkan12Features supportedFeatures12{};
+        bool vulkan12 = instanceApiVersion >= VK_API_VERSION_1_2 && physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_2;
+        if (vulkan12) {
+            vk::PhysicalDeviceFeatures2 features2{};
+            features2.setPNext(&supportedFeatures12);
+            physicalDevice.getFeatures2(&features2);
+        }
+        enabledFeatures12 = vk::PhysicalDeviceVulkan12Features{};
+        enabledFeatures12.setTimelineSemaphore(supportedFeatures12.timelineSemaphore);
+        timelineSemaphoreEnabled = supportedFeatures12.timelineSemaphore;
+
+        // Vulkan 1.1 drivers may still expose timeline semaphores through VK_KHR_timeline_semaphore. The dispatcher
+        // falls back to the KHR entry points for the core names the frame pacer calls.
+        auto extensions = getDeviceExtensions();
+        vk::PhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+        bool timelineExtension = false;
+        if (!vulkan12 && instanceApiVersion >= VK_API_VERSION_1_1 && physicalDevice.getProperties().apiVersion >= VK_API_VERSION_1_1) {
+            auto availableExtensions = physicalDevice.enumerateDeviceExtensionProperties();
+            timelineExtension = std::any_of(availableExtensions.begin(), availableExtensions.end(), [](const vk::ExtensionProperties& extension) {
+                return !strcmp(extension.extensionName, VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+            });
+        }
+        if (timelineExtension) {
+            vk::PhysicalDeviceFeatures2 features2{};
+            features2.setPNext(&timelineFeatures);
+            physicalDevice.getFeatures2(&features2);
+            timelineExtension = timelineFeatures.timelineSemaphore;
+        }
+        if (timelineExtension) {
+            extensions.push_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+            timelineFeatures = vk::PhysicalDeviceTimelineSemaphoreFeatures{};
+            timelineFeatures.setTimelineSemaphore(VK_TRUE);
+            timelineSemaphoreEnabled = true;
+        }
+        // Descriptor indexing for the bindless table, without it the triangles use a descriptor set per frame slot
+        bindlessSupported = vulkan12 && BindlessTable::enableFeatures(supportedFeatures12, enabledFeatures12);
 
         vk::DeviceCreateInfo createInfo{};
+        if (vulkan12) {
+            createInfo.setPNext(&enabledFeatures12);
+        } else if (timelineExtension) {
+            createInfo.setPNext(&timelineFeatures);
+        }
         createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pQueueCreateInfos = queueCreateInfos.data();
 #ifdef DEBUG
@@ -270,28 +522,32 @@ private:
         createInfo.ppEnabledLayerNames = nullptr;
 #endif
 
-        createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-        createInfo.pEnabledFeatures = &deviceFeatures;
+        createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+        createInfo.ppEnabledExtensionNames = extensions.data();
+        createInfo.pEnabledFeatures = &enabledFeatures;
 
         if (physicalDevice.createDevice(&createInfo, nullptr, &device) != vk::Result::eSuccess) {
             throw std::runtime_error("Failed to create logical device!");
         }
-        graphicsQueue = device.getQueue(indices.graphicsFamily.value(), 0);
-        presentQueue = device.getQueue(indices.presentFamily.value(), 0);
+#ifndef __ANDROID__
+        VULKAN_HPP_DEFAULT_DISPATCHER.init(device);
+#endif
+        graphicsQueue = device.getQueue(graphicsFamily, graphicsQueueIndex);
+        presentQueue = device.getQueue(indices.presentFamily.value(), presentQueueIndex);
+        computeQueue = device.getQueue(indices.computeFamily.value(), computeQueueIndex);
+        transferQueue = device.getQueue(indices.transferFamily.value_or(graphicsFamily), transferQueueIndex);
     }
 
-    void createSwapChain() {
+    // oldSwapchain hands the presentation engine over from the swapchain being replaced,
+    // which lets it keep presenting already queued images instead of requiring a full GPU drain
+    void createSwapChain(vk::SwapchainKHR oldSwapchain = nullptr) {
         SwapChainSupportDetails swapChainSupport = querySwapChainSupport(physicalDevice);
 
         auto surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
         auto presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
         auto extent = chooseSwapExtent(swapChainSupport.capabilities);
-        uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-        if (swapChainSupport.capabilities.maxImageCount > 0 && 
-            imageCount > swapChainSupport.capabilities.maxImageCount) {
-            imageCount = swapChainSupport.capabilities.maxImageCount;
-        }
+        // Fewer images mean fewer frames queued in front of the display, more absorb frame time spikes
+        uint32_t imageCount = chooseImageCount(options.presentPolicy, swapChainSupport.capabilities);
         vk::SwapchainCreateInfoKHR createInfo{};
         createInfo.surface = surface;
         createInfo.minImageCount = imageCount;
@@ -316,12 +572,42 @@ private:
         createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque; // alpha channel should not be used for blending with other windows
         createInfo.presentMode = presentMode;
         createInfo.clipped = true;
-        createInfo.oldSwapchain = nullptr;
+        createInfo.oldSwapchain = oldSwapchain;
         swapchain = device.createSwapchainKHR(createInfo);
 
         swapChainImages = device.getSwapchainImagesKHR(swapchain);
         swapChainImageFormat = surfaceFormat.format;
         swapChainExtent = extent;
+        if (!oldSwapchain) {
+            std::cout << "Present: " << presentPolicyName(options.presentPolicy) << ", " << vk::to_string(presentMode) << ", "
+                      << swapChainImages.size() << " image(s), " << options.framesInFlight << " frame(s) in flight";
+            if (frameLimiter.isEnabled()) {
+                std::cout << ", limited to " << options.targetFps << " fps";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    // Headless counterpart of createSwapChain: a single device-local image stands in for the swapchain images,
+    // so image views, framebuffers and command buffers are created exactly as in the windowed path.
+    void createOffscreenTarget() {
+        swapChainImageFormat = vk::Format::eR8G8B8A8Unorm;
+        swapChainExtent = options.headlessExtent;
+
+        vk::ImageCreateInfo imageInfo{};
+        imageInfo.setImageType(vk::ImageType::e2D)
+            .setFormat(swapChainImageFormat)
+            .setExtent({swapChainExtent.width, swapChainExtent.height, 1})
+            .setMipLevels(1)
+            .setArrayLayers(1)
+            .setSamples(vk::SampleCountFlagBits::e1)
+            .setTiling(vk::ImageTiling::eOptimal)
+            .setUsage(vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc) // transfer source for frame readback
+            .setSharingMode(vk::SharingMode::eExclusive)
+            .setInitialLayout(vk::ImageLayout::eUndefined);
+        offscreenImage = allocator.createImage(imageInfo, MemoryUsage::GpuOnly, offscreenAllocation);
+
+        swapChainImages = {offscreenImage};
     }
 
     void createImageViews() {
@@ -344,71 +630,418 @@ private:
         }
     }
 
-    void createRenderPass() {
-        vk::AttachmentDescription colorAttachment{};
-        colorAttachment.setFormat(swapChainImageFormat)
-            .setSamples(vk::SampleCountFlagBits::e1)   // Not using multisampling yet
-            .setLoadOp(vk::AttachmentLoadOp::eClear)   // clear operation to clear the framebuffer to black before drawing a new frame
-            .setStoreOp(vk::AttachmentStoreOp::eStore) // Rendered contents will be stored in memory and can be read later
-            .setInitialLayout(vk::ImageLayout::eUndefined) // The caveat of this special value is that the contents of the image are not guaranteed to be preserved, but that doesn't matter since we're going to clear it anyway.
-            .setFinalLayout(vk::ImageLayout::ePresentSrcKHR); //  We want the image to be ready for presentation using the swap chain after rendering
-
-        vk::AttachmentReference colorAttachmentRef{};
-        colorAttachmentRef.setAttachment(0) // Our array consists of a single VkAttachmentDescription, so its index is 0
-            .setLayout(vk::ImageLayout::eColorAttachmentOptimal); // use the attachment to function as a color buffer
-
-        vk::SubpassDescription subpass{};
-        subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics) // may also support compute subpasses in the future, so we have to be explicit about this being a graphics subpass
-            .setColorAttachmentCount(1)
-            .setPColorAttachments(&colorAttachmentRef); // The index of the attachment in this array is directly referenced from the fragment shader with the layout(location = 0) out vec4 outColor directive!
-
-        vk::SubpassDependency dependency{};
-        dependency.setSrcSubpass(VK_SUBPASS_EXTERNAL) // VK_SUBPASS_EXTERNAL means anything outside of a given render pass scope, it specifies anything that happened before the render pass
-            .setDstSubpass(0) //subpass index
-            //The next two fields specify the operations to wait on and the stages in which these operations occur
-            .setSrcStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-            //.setSrcAccessMask(0)
-            .setDstStageMask(vk::PipelineStageFlagBits::eColorAttachmentOutput)
-            .setDstAccessMask(vk::AccessFlagBits::eColorAttachmentWrite);
-
-        vk::RenderPassCreateInfo renderPassInfo{};
-        renderPassInfo.setAttachmentCount(1)
-            .setPAttachments(&colorAttachment)
-            .setSubpassCount(1)
-            .setPSubpasses(&subpass)
-            .setDependencyCount(1)
-            .setPDependencies(&dependency);
-        renderPass = device.createRenderPass(renderPassInfo);
+    // Declares the frame: every pass lists the images it renders to and samples, the graph derives the render
+    // passes, barriers and layout transitions. Only depends on the surface format, like the pipelines built against it.
+    void createRenderGraph() {
+        renderGraph.init(device, allocator, profiler);
+        // Headless frames are only ever copied out for readback, windowed ones are presented
+        auto backbuffer = renderGraph.importBackbuffer("backbuffer", swapChainImageFormat,
+                                                       options.headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR);
+        // The draws are recorded into secondary command buffers beforehand, see recordFrame()
+        mainPass = renderGraph.addPass("main pass", [this](vk::CommandBuffer commandBuffer, const RenderGraph::PassContext& context) {
+            const auto& frame = frameCommands[context.frameSlot];
+            commandBuffer.executeCommands(frame.secondaryCount, frame.secondaries.data());
+        }, vk::SubpassContents::eSecondaryCommandBuffers);
+        // Depth and multisampled color never leave the pass: they are cleared on load, dropped on store and the
+        // samples are resolved into the backbuffer at the end of the subpass, so tilers keep them in tile memory
+        // and back them with lazily allocated memory
+        mainPassSamples = supportedSampleCount(options.msaaSamples);
+        vk::Format depthFormat = findDepthFormat();
+        auto depth = renderGraph.createImage("depth", depthFormat, 1.0f, mainPassSamples);
+        vk::ClearValue clearColor(std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f});
+        if (mainPassSamples == vk::SampleCountFlagBits::e1) {
+            renderGraph.write(mainPass, backbuffer, clearColor);
+        } else {
+            auto color = renderGraph.createImage("multisampled color", swapChainImageFormat, 1.0f, mainPassSamples);
+            renderGraph.write(mainPass, color, clearColor);
+            renderGraph.resolve(mainPass, color, backbuffer);
+        }
+        renderGraph.write(mainPass, depth, vk::ClearValue(vk::ClearDepthStencilValue(1.0f, 0)));
+        renderGraph.compile();
+
+        renderPass = renderGraph.renderPass(mainPass);
+        renderPassKey = renderGraph.compatibilityKey(mainPass);
+        auto stats = renderGraph.stats();
+        std::cout << "Render graph: " << stats.passes << " pass(es), " << stats.culledPasses << " culled, "
+                  << stats.transientImages << " transient image(s), " << stats.barriers << " barrier(s) per frame, "
+                  << static_cast<uint32_t>(mainPassSamples) << "x MSAA, " << vk::to_string(depthFormat) << " depth" << std::endl;
+    }
+
+    // The highest sample count up to the requested one that both color and depth attachments support
+    vk::SampleCountFlagBits supportedSampleCount(uint32_t requested) {
+        auto limits = physicalDevice.getProperties().limits;
+        vk::SampleCountFlags supported = limits.framebufferColorSampleCounts & limits.framebufferDepthSampleCounts;
+        for (uint32_t samples = requested; samples > 1; samples /= 2) {
+            if (supported & static_cast<vk::SampleCountFlagBits>(samples)) {
+                return static_cast<vk::SampleCountFlagBits>(samples);
+            }
+        }
+        return vk::SampleCountFlagBits::e1;
+    }
+
+    vk::Format findDepthFormat() {
+        // No stencil is needed, every device supports at least one of the first and the last one
+        for (vk::Format format : {vk::Format::eD32Sfloat, vk::Format::eX8D24UnormPack32, vk::Format::eD16Unorm}) {
+            if (physicalDevice.getFormatProperties(format).optimalTilingFeatures & vk::FormatFeatureFlagBits::eDepthStencilAttachment) {
+                return format;
+            }
+        }
+        throw std::runtime_error("failed to find a supported depth format!");
+    }
+
+    // Steps through 1x, 2x, 4x and 8x MSAA, wrapping around at the first count the device does not support.
+    // The render passes and pipelines depend on the sample count, so this drains the GPU like a format change.
+    void cycleSampleCount() {
+        uint32_t next = static_cast<uint32_t>(mainPassSamples) * 2;
+        if (next > 8 || static_cast<uint32_t>(supportedSampleCount(next)) != next) {
+            next = 1;
+        }
+        if (next == static_cast<uint32_t>(mainPassSamples)) {
+            return;
+        }
+        options.msaaSamples = next;
+        device.waitIdle();
+        renderGraph.destroyAttachments(graphAttachments);
+        cleanupPipeline();
+        createRenderGraph();
+        createGraphicsPipeline();
+        createGraphAttachments();
     }
 
     void createGraphicsPipeline() {
-        auto vertShaderCode = readFile(getShaderPath() + "/shader.vert.spv");
-        auto fragShaderCode = readFile(getShaderPath() + "/shader.frag.spv");
-        auto vertShaderModule = createShaderModule(vertShaderCode);
-        auto fragShaderModule = createShaderModule(fragShaderCode);
+        // for uniform values in shaders
+        // The structure also specifies push constants, 
+        // which are another way of passing dynamic values to shaders.
+        // With the bindless table the triangles find the frame's offsets through a handle in a push constant,
+        // otherwise through a descriptor set per frame slot
+        bool useBindless = bindless.isValid();
+        vk::DescriptorSetLayout setLayout = useBindless ? bindless.layout() : simulationSetLayout;
+        vk::PushConstantRange handleRange(vk::ShaderStageFlagBits::eVertex, 0, sizeof(BindlessTable::Handle));
+        vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.setSetLayoutCount(1)
+            .setPSetLayouts(&setLayout)
+            .setPushConstantRangeCount(useBindless ? 1 : 0)
+            .setPPushConstantRanges(useBindless ? &handleRange : nullptr);
+        pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+
+        GraphicsPipelineDesc desc{};
+        desc.samples = mainPassSamples;
+        desc.layout = pipelineLayout;
+        desc.renderPass = renderPass;
+        desc.renderPassCompatibility = renderPassKey;
+        createShaderPipeline(desc, useBindless ? "bindless.vert.spv" : "shader.vert.spv", "shader.frag.spv", graphicsPipeline);
+
+        if (options.instanceCount > 0) {
+            vk::DescriptorSetLayout sceneSetLayout = scene.setLayout();
+            vk::PushConstantRange pushConstantRange(vk::ShaderStageFlagBits::eVertex, 0, InstancedScene::k_pushConstantSize);
+            vk::PipelineLayoutCreateInfo sceneLayoutInfo{};
+            sceneLayoutInfo.setSetLayoutCount(1)
+                .setPSetLayouts(&sceneSetLayout)
+                .setPushConstantRangeCount(1)
+                .setPPushConstantRanges(&pushConstantRange);
+            scenePipelineLayout = device.createPipelineLayout(sceneLayoutInfo);
+
+            GraphicsPipelineDesc sceneDesc{};
+            sceneDesc.vertexBindings = InstancedScene::vertexBindings();
+            sceneDesc.vertexAttributes = InstancedScene::vertexAttributes();
+            // The meshes are wound counter-clockwise, the projection flips Y so they stay counter-clockwise on screen
+            sceneDesc.frontFace = vk::FrontFace::eCounterClockwise;
+            sceneDesc.samples = mainPassSamples;
+            sceneDesc.depthTest = true;
+            sceneDesc.layout = scenePipelineLayout;
+            sceneDesc.renderPass = renderPass;
+            sceneDesc.renderPassCompatibility = renderPassKey;
+            createShaderPipeline(sceneDesc, "instanced.vert.spv", "shader.frag.spv", scenePipeline);
+        }
+
+        if (meshFile.isOpen()) {
+            // The camera and lights do not fit into push constants, they are bound from the uniform ring at set 0
+            std::vector<vk::DescriptorSetLayout> setLayouts;
+            std::vector<vk::PushConstantRange> pushConstantRanges;
+            uniformRing.describeConstants(sizeof(MeshConstants), k_meshConstantStages, setLayouts, pushConstantRanges);
+            vk::PipelineLayoutCreateInfo meshLayoutInfo{};
+            meshLayoutInfo.setSetLayoutCount(static_cast<uint32_t>(setLayouts.size()))
+                .setPSetLayouts(setLayouts.data())
+                .setPushConstantRangeCount(static_cast<uint32_t>(pushConstantRanges.size()))
+                .setPPushConstantRanges(pushConstantRanges.data());
+            meshPipelineLayout = device.createPipelineLayout(meshLayoutInfo);
+
+            // The vertex input state comes from the file, whatever streams and attributes it declares
+            GraphicsPipelineDesc meshDesc{};
+            meshDesc.vertexBindings = meshFile.vertexBindings();
+            meshDesc.vertexAttributes = meshFile.vertexAttributes();
+            meshDesc.frontFace = vk::FrontFace::eCounterClockwise;
+            meshDesc.samples = mainPassSamples;
+            meshDesc.depthTest = true;
+            meshDesc.layout = meshPipelineLayout;
+            meshDesc.renderPass = renderPass;
+            meshDesc.renderPassCompatibility = renderPassKey;
+            createShaderPipeline(meshDesc, "mesh.vert.spv", "mesh.frag.spv", meshPipeline);
+        }
+    }
+
+    // Looks the pipeline up in the registry, a new one is queued on the builder and target stays null until
+    // updatePipelines() swaps it in
+    void createShaderPipeline(const GraphicsPipelineDesc& desc, const std::string& vertexShader, const std::string& fragmentShader,
+                              vk::Pipeline& target) {
+        pipelineRegistry.request(desc, vertexShader, fragmentShader, target);
+    }
+
+    // Development mode: watches the compiled shaders next to the executable
+    void startShaderWatcher() {
+        if (!options.hotReload) {
+            return;
+        }
+#if defined(NARU_EMBED_SHADERS) || defined(__ANDROID__)
+        std::cout << "Hot reload: unavailable, shaders are not loaded from a directory" << std::endl;
+        options.hotReload = false;
+#else
+        shaderWatcher.start(getExecutablePath() + "/shaders");
+        std::cout << "Hot reload: watching " << getExecutablePath() + "/shaders" << std::endl;
+#endif
+    }
 
-        vk::PipelineShaderStageCreateInfo vertShaderStageInfo{};
-        vertShaderStageInfo.stage = vk::ShaderStageFlagBits::eVertex;
-        vertShaderStageInfo.module = vertShaderModule;
-        vertShaderStageInfo.pName = "main";
+    // Runs at the frame boundary, before anything is recorded: swaps in the pipelines the builder finished and,
+    // in hot reload mode, queues rebuilds for the shaders that changed. Never waits for a build.
+    void updatePipelines() {
+        auto update = pipelineRegistry.update();
+        for (auto& result : update.built) {
+            const auto& request = result.request;
+            if (!result.pipeline) {
+                if (!options.hotReload) {
+                    throw std::runtime_error("failed to create graphics pipeline: " + result.error);
+                }
+                // The previous pipeline stays in use until the shader is fixed
+                std::cerr << "Hot reload: " << request.vertexShader << " + " << request.fragmentShader << " failed, "
+                          << result.error << std::endl;
+            } else if (pipelinesReported) {
+                std::cout << "Hot reload: rebuilt " << request.vertexShader << " + " << request.fragmentShader
+                          << " in " << result.milliseconds << " ms" << std::endl;
+            }
+        }
+        for (auto pipeline : update.replaced) {
+            // Frames already submitted keep using the old pipeline
+            retiredPipelines.push_back({framePacer.lastSubmittedFrame(), pipeline});
+        }
+        while (!retiredPipelines.empty() && framePacer.frameCompleted(retiredPipelines.front().first)) {
+            device.destroyPipeline(retiredPipelines.front().second);
+            retiredPipelines.pop_front();
+        }
+        if (!pipelinesReported && pipelineRegistry.pending() == 0) {
+            pipelinesReported = true;
+            auto stats = pipelineRegistry.stats();
+            std::cout << "Pipelines: " << stats.pipelines << " ready "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pipelineBatchStart).count()
+                      << " ms after the first request on " << pipelineBuilder.threadCount() << " builder thread(s), "
+                      << stats.hits << " registry hit(s), " << stats.misses << " miss(es)" << std::endl;
+        }
+
+        if (!options.hotReload) {
+            return;
+        }
+        for (auto& name : shaderWatcher.changes()) {
+            pipelineRegistry.rebuild(name);
+        }
+    }
+
+    // Blocks until every queued pipeline is ready, for the paths that need all of them (headless runs)
+    void waitForPipelines() {
+        pipelineBuilder.wait();
+        updatePipelines();
+    }
+
+    // Only called with the device idle, before the layouts and render pass the queued builds refer to go away
+    void dropPendingPipelines() {
+        pipelineRegistry.clear();
+        for (auto& [frame, pipeline] : retiredPipelines) {
+            device.destroyPipeline(pipeline);
+        }
+        retiredPipelines.clear();
+    }
+
+    void loadPipelineCache() {
+        auto properties = physicalDevice.getProperties();
+        pipelineCache.load(device, properties, getPipelineCachePath(properties));
+        // Leaves one core to the main thread, which keeps initializing while the pipelines compile
+        uint32_t builderThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        pipelineBuilder.init(device, pipelineCache.get(), builderThreads,
+                             [this](const std::string& name) { return loadShader(name); });
+        pipelineRegistry.init(device, pipelineBuilder);
+        pipelineBatchStart = std::chrono::steady_clock::now();
+        pipelinesReported = false;
+    }
+
+    void destroyPipelineCache() {
+        // Merges the builder's caches into the shared one before it is written out
+        pipelineBuilder.destroy();
+        pipelineCache.save();
+        pipelineCache.destroy();
+    }
+
+    // One file per GPU so that machines with several devices keep a warm cache for each of them
+    std::string getPipelineCachePath(const vk::PhysicalDeviceProperties& properties) {
+        char fileName[64];
+        snprintf(fileName, sizeof(fileName), "pipeline_cache_%04x_%04x.bin", properties.vendorID, properties.deviceID);
+        return pipelineCacheDirectory + fileName;
+    }
+
+    // Framebuffers and transient images for the current extent, they are retired along with the swapchain
+    void createGraphAttachments() {
+        graphAttachments = renderGraph.createAttachments(swapChainExtent, swapChainImages, swapChainImageViews);
+        if (graphAttachments.imageBytes > 0) {
+            std::cout << "Render graph: " << (graphAttachments.boundBytes >> 10) << " KiB of transient attachments, "
+                      << (graphAttachments.imageBytes >> 10) << " KiB without aliasing"
+                      << (allocator.hasLazilyAllocatedMemory() ? ", pass-local ones lazily allocated" : "") << std::endl;
+        }
+    }
+
+    // Pool for one-off command buffers outside of the frame loop (e.g. headless readback)
+    void createCommandPool() {
+        auto queueFamiliesIndices = findQueueFamilies(physicalDevice);
+        vk::CommandPoolCreateInfo poolInfo{};
+        poolInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+            .setQueueFamilyIndex(queueFamiliesIndices.graphicsFamily.value());
+        commandPool = device.createCommandPool(poolInfo);
+    }
+
+    // Every frame in flight owns one pool per recording thread, so threads never share a pool
+    // and a whole frame's worth of command buffers is recycled with a single resetCommandPool.
+    void createFrameCommands() {
+        auto queueFamiliesIndices = findQueueFamilies(physicalDevice);
+        uint32_t threadCount = workers->concurrency();
+        frameCommands.resize(framePacer.depth());
+        for (auto& frame : frameCommands) {
+            vk::CommandPoolCreateInfo poolInfo{};
+            // eTransient: command buffers are short-lived, they are re-recorded every time the frame slot comes around
+            poolInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient)
+                .setQueueFamilyIndex(queueFamiliesIndices.graphicsFamily.value());
+            frame.pools.resize(threadCount);
+            frame.secondaries.resize(threadCount);
+            for (uint32_t thread = 0; thread < threadCount; thread++) {
+                frame.pools[thread] = device.createCommandPool(poolInfo);
+                // CBLevel::ePrimary: Can be submitted to a queue for execution, but cannot be called from other command buffers.
+                // CBLevel::eSecondary: Cannot be submitted directly, but can be called from primary command buffers.
+                vk::CommandBufferAllocateInfo allocInfo{};
+                allocInfo.setCommandPool(frame.pools[thread])
+                    .setLevel(vk::CommandBufferLevel::eSecondary)
+                    .setCommandBufferCount(1);
+                frame.secondaries[thread] = device.allocateCommandBuffers(allocInfo)[0];
+            }
+            vk::CommandBufferAllocateInfo allocInfo{};
+            allocInfo.setCommandPool(frame.pools[0]) // the primary is always recorded by the calling thread
+                .setLevel(vk::CommandBufferLevel::ePrimary)
+                .setCommandBufferCount(1);
+            frame.primary = device.allocateCommandBuffers(allocInfo)[0];
+        }
+    }
 
-        vk::PipelineShaderStageCreateInfo fragShaderStageInfo{};
-        fragShaderStageInfo.stage = vk::ShaderStageFlagBits::eFragment;
-        fragShaderStageInfo.module = fragShaderModule;
-        fragShaderStageInfo.pName = "main";
+    void destroyFrameCommands() {
+        for (auto& frame : frameCommands) {
+            for (auto pool : frame.pools) {
+                device.destroyCommandPool(pool); // also frees the command buffers allocated from it
+            }
+        }
+        frameCommands.clear();
+    }
 
-        vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+    // Records the frame into the command buffers of the current frame slot.
+    // The draws are split in contiguous ranges, each recorded into its own secondary command buffer on a worker thread.
+    void recordFrame(FrameCommands& frame, uint32_t frameSlot, uint32_t imageIndex) {
+        for (auto pool : frame.pools) {
+            device.resetCommandPool(pool, {});
+        }
 
-        vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
-        vertexInputInfo.setVertexBindingDescriptionCount(0)
-                       .setVertexAttributeDescriptionCount(0);
-        vertexInputInfo.pVertexBindingDescriptions = nullptr;
-        vertexInputInfo.pVertexAttributeDescriptions = nullptr;
+        vk::CommandBufferBeginInfo beginInfo{};
+        beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit);
+        frame.primary.begin(beginInfo);
+        profiler.beginGpuFrame(frame.primary, frameSlot);
+        // Acquire finished uploads first, everything recorded after this point may use them
+        frame.uploadWaits.clear();
+        frame.uploadWaitStages.clear();
+        uploads.collectAcquires(frame.primary, framePacer.currentFrame(), frame.uploadWaits, frame.uploadWaitStages);
+
+        // The GPU-driven scene replaces the triangles: one cull dispatch and an indirect draw per mesh, whatever the instance count
+        bool sceneMode = options.instanceCount > 0;
+        bool drawScene = false;
+        if (sceneMode) {
+            scene.update(framePacer.currentFrame(), float(swapChainExtent.width) / float(swapChainExtent.height));
+            uint32_t cullScope = profiler.beginGpuScope(frame.primary, "cull");
+            drawScene = scene.recordCull(frame.primary);
+            profiler.endGpuScope(frame.primary, cullScope);
+        }
+        bool meshMode = meshFile.isOpen();
+        if (meshMode && !meshReady) {
+            UploadTicket ticket = meshTicket.load(std::memory_order_acquire);
+            meshReady = ticket != 0 && uploads.isReady(ticket);
+        }
+        if (meshReady) {
+            updateMeshCamera(framePacer.currentFrame(), float(swapChainExtent.width) / float(swapChainExtent.height));
+        }
+
+        // Small frames are not worth waking up the workers for
+        uint32_t chunkCount = (sceneMode || meshMode) ? 1 : std::clamp((options.drawCount + k_minDrawsPerThread - 1) / k_minDrawsPerThread,
+                                                         1u, static_cast<uint32_t>(frame.secondaries.size()));
+        vk::CommandBufferInheritanceInfo inheritanceInfo{};
+        inheritanceInfo.setRenderPass(renderPass)
+            .setSubpass(0)
+            .setFramebuffer(renderGraph.framebuffer(graphAttachments, mainPass, imageIndex));
+        workers->parallelFor(chunkCount, [&](uint32_t chunk) {
+            uint32_t firstDraw = static_cast<uint32_t>(uint64_t(options.drawCount) * chunk / chunkCount);
+            uint32_t lastDraw = static_cast<uint32_t>(uint64_t(options.drawCount) * (chunk + 1) / chunkCount);
+            vk::CommandBuffer commandBuffer = frame.secondaries[chunk];
+            vk::CommandBufferBeginInfo beginInfo{};
+            // eOneTimeSubmit: specifies that each recording of the command buffer will only be submitted once, and the command buffer will be reset and recorded again between each submission
+            // eRenderPassContinue: This is a secondary command buffer that will be entirely within a single render pass.
+            beginInfo.setFlags(vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue)
+                .setPInheritanceInfo(&inheritanceInfo);
+            commandBuffer.begin(beginInfo);
+            if (sceneMode || meshMode) {
+                setViewportAndScissor(commandBuffer);
+                // Pipelines still compiling are skipped, the frame draws whatever is ready
+                if (drawScene && scenePipeline) {
+                    scene.recordDraw(commandBuffer, scenePipeline, scenePipelineLayout);
+                }
+                if (meshReady && meshPipeline) {
+                    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, meshPipeline);
+                    uniformRing.bindConstants(commandBuffer, meshPipelineLayout, k_meshConstantStages, 0,
+                                              &meshConstants, sizeof(meshConstants));
+                    gpuMesh.draw(commandBuffer);
+                }
+                commandBuffer.end();
+                return;
+            }
+            if (!graphicsPipeline) {
+                commandBuffer.end();
+                return;
+            }
+            // Secondary command buffers do not inherit pipeline or dynamic state from the primary
+            commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline); // first parameter specifies if is a graphics or compute pipeline
+            if (bindless.isValid()) {
+                // One bind for the whole command buffer, the draws only need the handle
+                bindless.bind(commandBuffer, vk::PipelineBindPoint::eGraphics, pipelineLayout);
+                commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(BindlessTable::Handle),
+                                            &simulationHandles[frameSlot]);
+            } else {
+                commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &simulationSets[frameSlot], 0, nullptr);
+            }
+            setViewportAndScissor(commandBuffer);
+            for (uint32_t draw = firstDraw; draw < lastDraw; draw++) {
+                commandBuffer.draw(3, 1, 0, draw); // the draw index doubles as instance index into the simulation output
+                // vertexCount: Even though we don't have a vertex buffer, we technically still have 3 vertices to draw.
+                // instanceCount: Used for instanced rendering, use 1 if you're not doing that.
+                // firstVertex: Used as an offset into the vertex buffer, defines the lowest value of gl_VertexIndex.
+                // firstInstance: Used as an offset for instanced rendering, defines the lowest value of gl_InstanceIndex.
+            }
+            commandBuffer.end();
+        });
 
-        vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
-        inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
-        inputAssembly.primitiveRestartEnable = false;
+        // The graph begins the render pass, executes the secondaries and transitions the image for present or readback
+        frame.secondaryCount = chunkCount;
+        renderGraph.execute(frame.primary, graphAttachments, imageIndex, frameSlot);
+        frame.primary.end();
+    }
 
+    void setViewportAndScissor(vk::CommandBuffer commandBuffer) {
         vk::Viewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
@@ -416,224 +1049,351 @@ private:
         viewport.height = (float)swapChainExtent.height;
         viewport.minDepth = 0.0f;
         viewport.maxDepth = 1.0f;
-
         vk::Rect2D scissor({0, 0}, swapChainExtent);
+        commandBuffer.setViewport(0, 1, &viewport);
+        commandBuffer.setScissor(0, 1, &scissor);
+    }
 
-        vk::PipelineViewportStateCreateInfo viewportState({}, 1, &viewport, 1, &scissor);
-
-        vk::PipelineRasterizationStateCreateInfo rasterizer{};
-        rasterizer.setDepthClampEnable(false) // fragments that are beyond the near and far planes are clamped to them
-            .setRasterizerDiscardEnable(false) // if true geometry never passes through the rasterizer stage. This basically disables any output to the framebuffer
-            .setPolygonMode(vk::PolygonMode::eFill) // Using any mode other than fill requires enabling a GPU feature.
-            .setLineWidth(1.0f)
-            .setCullMode(vk::CullModeFlagBits::eBack)
-            .setFrontFace(vk::FrontFace::eClockwise)
-            .setDepthBiasEnable(false) //to alter the depth values by adding a constant value or biasing them based on a fragment's slope. This is sometimes used for shadow mapping.
-            .setDepthBiasConstantFactor(0.0f)
-            .setDepthBiasClamp(0.0f)
-            .setDepthBiasSlopeFactor(0.0f);
-
-        vk::PipelineMultisampleStateCreateInfo multisampling{};
-        multisampling.setSampleShadingEnable(false) // configures multisampling, which is one of the ways to perform anti-aliasing
-            .setRasterizationSamples(vk::SampleCountFlagBits::e1)
-            .setMinSampleShading(1.0f)
-            .setPSampleMask(nullptr)
-            .setAlphaToCoverageEnable(false)
-            .setAlphaToOneEnable(false);
-
-        //TODO: Depth and stencil testing
-
-        // color blending settings per framebuffer
-        vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
-        colorBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-                                               vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
-            .setBlendEnable(false)
-            .setSrcColorBlendFactor(vk::BlendFactor::eOne)
-            .setDstColorBlendFactor(vk::BlendFactor::eZero)
-            .setColorBlendOp(vk::BlendOp::eAdd)
-            .setSrcAlphaBlendFactor(vk::BlendFactor::eOne)
-            .setDstAlphaBlendFactor(vk::BlendFactor::eZero)
-            .setAlphaBlendOp(vk::BlendOp::eAdd);
-        // Pseudocode for color blending:
-        // if (blendEnable) {
-        //     finalColor.rgb = (srcColorBlendFactor * newColor.rgb) <colorBlendOp> (dstColorBlendFactor * oldColor.rgb);
-        //     finalColor.a = (srcAlphaBlendFactor * newColor.a) <alphaBlendOp> (dstAlphaBlendFactor * oldColor.a);
-        // } else {
-        //     finalColor = newColor;
-        // }
-        // finalColor = finalColor & colorWriteMask;
-
-        // global color blending settings -> for all framebuffers
-        vk::PipelineColorBlendStateCreateInfo colorBlending{};
-        colorBlending.setLogicOpEnable(false)
-            .setLogicOp(vk::LogicOp::eCopy)
-            .setAttachmentCount(1)
-            .setPAttachments(&colorBlendAttachment)
-            .setBlendConstants({0.0f, 0.0f, 0.0f, 0.0f});
-
-        vk::DynamicState dynamicStates[] = {
-            vk::DynamicState::eViewport,
-            vk::DynamicState::eLineWidth
-        };
-        vk::PipelineDynamicStateCreateInfo dynamicState{};
-        dynamicState.setDynamicStateCount(2)
-            .setPDynamicStates(dynamicStates);
+    // Device lifetime, the pipelines and every subsystem handing out handles are created after it
+    void createBindlessTable() {
+        if (!bindlessSupported) {
+            std::cout << "Bindless: descriptor indexing not supported, descriptor sets per frame slot" << std::endl;
+            return;
+        }
+        bindless.init(physicalDevice, device, framePacer);
+        std::cout << "Bindless: " << bindless.capacity(BindlessTable::SampledImages) << " sampled images, "
+                  << bindless.capacity(BindlessTable::StorageBuffers) << " storage buffers, "
+                  << bindless.capacity(BindlessTable::Samplers) << " samplers, update after bind" << std::endl;
+    }
 
-        // for uniform values in shaders
-        // The structure also specifies push constants, 
-        // which are another way of passing dynamic values to shaders.
-        vk::PipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.setSetLayoutCount(0)
-            .setPSetLayouts(nullptr)
-            .setPushConstantRangeCount(0)
-            .setPPushConstantRanges(nullptr);
-        pipelineLayout = device.createPipelineLayout(pipelineLayoutInfo);
+    // Must run before createFrameCommands, the frame pacer decides how many frame slots there are
+    void createFramePacer() {
+        framePacer.init(device, options.framesInFlight, timelineSemaphoreEnabled);
+        std::cout << "Frame pacing: " << framePacer.depth() << " frame(s) in flight, "
+                  << (framePacer.usesTimeline() ? "timeline semaphore" : "fences") << std::endl;
+    }
 
-        vk::GraphicsPipelineCreateInfo pipelineInfo{};
-        pipelineInfo.setStageCount(2)
-            .setPStages(shaderStages)
-            .setPVertexInputState(&vertexInputInfo)
-            .setPInputAssemblyState(&inputAssembly)
-            .setPViewportState(&viewportState)
-            .setPRasterizationState(&rasterizer)
-            .setPMultisampleState(&multisampling)
-            .setPDepthStencilState(nullptr)
-            .setPColorBlendState(&colorBlending)
-            .setPDynamicState(nullptr)
-            .setLayout(pipelineLayout)
-            .setRenderPass(renderPass) // It is also possible to use other render passes with this pipeline instead of this specific instance, but they have to be compatible
-            .setSubpass(0)             // index of the sub pass where this graphics pipeline will be used
-            // Vulkan allows you to create a new graphics pipeline by deriving from an existing pipeline.
-            // The idea of pipeline derivatives is that it is less expensive to set up pipelines when they have much functionality
-            // in common with an existing pipeline and switching between pipelines from the same parent can also be done quicker
-            .setBasePipelineHandle(nullptr)
-            .setBasePipelineIndex(-1);
-
-        graphicsPipeline = device.createGraphicsPipeline({}, pipelineInfo);
-
-        device.destroyShaderModule(vertShaderModule);
-        device.destroyShaderModule(fragShaderModule);
-    }
-
-    void createFramebuffers() {
-        swapChainFramebuffers.resize(swapChainImageViews.size());
-        for (size_t index = 0; index < swapChainImageViews.size(); index++) {
-            vk::ImageView attachments[] = { swapChainImageViews[index] };
-            vk::FramebufferCreateInfo frameBufferInfo{};
-            frameBufferInfo.setRenderPass(renderPass) // specify with which renderPass needs to be compatible
-                .setAttachmentCount(1)
-                .setPAttachments(attachments)
-                .setWidth(swapChainExtent.width)
-                .setHeight(swapChainExtent.height)
-                .setLayers(1); // Our swap chain images are single images, so the number of layers is 1
-            swapChainFramebuffers[index] = device.createFramebuffer(frameBufferInfo);
+    // Per-frame and per-draw constants, one region of the ring per frame slot
+    void createUniformRing() {
+        uniformRing.init(physicalDevice, allocator, framePacer.depth());
+        std::cout << "Constants: " << (UniformRing::k_defaultBytesPerFrame >> 10) << " KiB ring per frame slot, push constants up to "
+                  << UniformRing::k_pushConstantBytes << " bytes" << std::endl;
+    }
+
+    void createUploadManager() {
+        auto indices = findQueueFamilies(physicalDevice);
+        uint32_t transferFamily = indices.transferFamily.value_or(indices.graphicsFamily.value());
+        // When the queue is also used by the render thread both sides submit to it and have to take turns
+        bool sharedQueue = transferQueue == graphicsQueue || transferQueue == computeQueue;
+        uploads.init(physicalDevice, device, allocator, framePacer, transferFamily, transferQueue,
+                     indices.graphicsFamily.value(), sharedQueue ? &graphicsQueueMutex : nullptr);
+        std::cout << "Uploads: " << (indices.transferFamily ? "dedicated transfer queue family " + std::to_string(transferFamily)
+                                     : sharedQueue ? std::string("shared queue") : std::string("extra graphics queue"))
+                  << ", " << (UploadManager::k_defaultStagingSize >> 20) << " MiB staging ring" << std::endl;
+    }
+
+    // Binding 0: simulate.comp writes per-draw offsets that the vertex shader reads
+    void createSimulationLayout() {
+        vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eStorageBuffer, 1,
+                                               vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex);
+        vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.setBindingCount(1)
+            .setPBindings(&binding);
+        simulationSetLayout = device.createDescriptorSetLayout(layoutInfo);
+    }
+
+    void createSimulation() {
+        auto indices = findQueueFamilies(physicalDevice);
+        uint32_t computeFamily = indices.computeFamily.value();
+        asyncCompute.init(device, computeFamily, computeQueue, framePacer.depth(),
+                          computeQueue == graphicsQueue || computeQueue == transferQueue ? &graphicsQueueMutex : nullptr);
+
+        // One buffer per frame slot: the compute queue fills the next frame's offsets while the current frame still reads its own.
+        // Concurrent sharing spares the per-frame ownership transfers between the two families.
+        uint32_t queueFamilyIndices[] = {indices.graphicsFamily.value(), computeFamily};
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.setSize(vk::DeviceSize(std::max(options.drawCount, 1u)) * sizeof(float) * 4)
+            .setUsage(vk::BufferUsageFlagBits::eStorageBuffer);
+        if (computeFamily != indices.graphicsFamily.value()) {
+            bufferInfo.setSharingMode(vk::SharingMode::eConcurrent)
+                .setQueueFamilyIndexCount(2)
+                .setPQueueFamilyIndices(queueFamilyIndices);
+        } else {
+            bufferInfo.setSharingMode(vk::SharingMode::eExclusive);
+        }
+        simulationBuffers.resize(framePacer.depth());
+        simulationAllocations.resize(framePacer.depth());
+        for (uint32_t slot = 0; slot < framePacer.depth(); slot++) {
+            simulationBuffers[slot] = allocator.createBuffer(bufferInfo, MemoryUsage::GpuOnly, simulationAllocations[slot]);
         }
+
+        vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, framePacer.depth());
+        vk::DescriptorPoolCreateInfo poolInfo{};
+        poolInfo.setMaxSets(framePacer.depth())
+            .setPoolSizeCount(1)
+            .setPPoolSizes(&poolSize);
+        simulationDescriptorPool = device.createDescriptorPool(poolInfo);
+        std::vector<vk::DescriptorSetLayout> setLayouts(framePacer.depth(), simulationSetLayout);
+        vk::DescriptorSetAllocateInfo allocInfo{};
+        allocInfo.setDescriptorPool(simulationDescriptorPool)
+            .setDescriptorSetCount(framePacer.depth())
+            .setPSetLayouts(setLayouts.data());
+        simulationSets = device.allocateDescriptorSets(allocInfo);
+        for (uint32_t slot = 0; slot < framePacer.depth(); slot++) {
+            vk::DescriptorBufferInfo descriptorBuffer(simulationBuffers[slot], 0, VK_WHOLE_SIZE);
+            vk::WriteDescriptorSet write{};
+            write.setDstSet(simulationSets[slot])
+                .setDstBinding(0)
+                .setDescriptorCount(1)
+                .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+                .setPBufferInfo(&descriptorBuffer);
+            device.updateDescriptorSets(1, &write, 0, nullptr);
+            if (bindless.isValid()) {
+                simulationHandles.push_back(bindless.addBuffer(simulationBuffers[slot]));
+            }
+        }
+
+        auto shaderModule = loadShader("simulate.comp.spv");
+        simulationPipeline.create(device, shaderModule, {simulationSetLayout}, sizeof(SimulationConstants), pipelineCache.get());
+        device.destroyShaderModule(shaderModule);
+        std::cout << "Async compute: queue family " << computeFamily
+                  << (computeFamily != indices.graphicsFamily.value() ? " (compute only)" : " (shared with graphics)") << std::endl;
     }
 
-    void createCommandPool() {
-        auto queueFamiliesIndices = findQueueFamilies(physicalDevice);
-        vk::CommandPoolCreateInfo poolInfo{};
-        poolInfo.setQueueFamilyIndex(queueFamiliesIndices.graphicsFamily.value());
-        commandPool = device.createCommandPool(poolInfo);
+    // Records and submits this frame's simulation step, returns the semaphore the graphics submission waits on
+    vk::Semaphore submitSimulation(uint32_t frameSlot) {
+        vk::CommandBuffer commandBuffer = asyncCompute.begin(frameSlot);
+        // Derived from the frame number rather than the clock so headless runs produce identical frames
+        SimulationConstants constants{float(framePacer.currentFrame()) / 60.0f, options.drawCount};
+        simulationPipeline.bind(commandBuffer, simulationSets[frameSlot]);
+        simulationPipeline.pushConstants(commandBuffer, &constants, sizeof(constants));
+        commandBuffer.dispatch(ComputePipeline::groupCount(options.drawCount, 64), 1, 1);
+        return asyncCompute.submit(frameSlot);
     }
 
-    void createCommandBuffers() {
-        commandBuffers.resize(swapChainFramebuffers.size());
-        vk::CommandBufferAllocateInfo allocInfo{};
-        allocInfo.setCommandPool(commandPool)
-            .setLevel(vk::CommandBufferLevel::ePrimary)
-            .setCommandBufferCount((uint32_t)commandBuffers.size());
-        commandBuffers = device.allocateCommandBuffers(allocInfo);
-        // CBLevel::ePrimary: Can be submitted to a queue for execution, but cannot be called from other command buffers.
-        // CBLevel::eSecondary: Cannot be submitted directly, but can be called from primary command buffers.
-        for (size_t index = 0; index < commandBuffers.size(); index++) {
-            vk::CommandBufferBeginInfo beginInfo{};
-            // eOneTimeSubmit: specifies that each recording of the command buffer will only be submitted once, and the command buffer will be reset and recorded again between each submission
-            // eRenderPassContinue: This is a secondary command buffer that will be entirely within a single render pass.
-            // eSimultaneousUse: The command buffer can be resubmitted while it is also already pending execution.
-            // None of these flags are applicable for us right now.
-            commandBuffers[index].begin(beginInfo);
-            
-            vk::RenderPassBeginInfo renderPassInfo{};
-            vk::ClearValue clearColor(std::array<float, 4> {0.0f, 0.0f, 0.0f, 1.0f});
-            renderPassInfo.setRenderPass(renderPass)
-                .setFramebuffer(swapChainFramebuffers[index])
-                .setRenderArea({{0, 0}, swapChainExtent}) // Size of the render area. The render area defines where shader loads and stores will take place. It should match the size of the attachments for best performance
-                .setClearValueCount(1)
-                .setPClearValues(&clearColor); // clear values for AttachmentLoadOp::eClear
-            commandBuffers[index].beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-            // SubpassContents::eInline: The render pass commands will be embedded in the primary command buffer itself and no secondary command buffers will be executed.
-            // SubpassContents::eSecondaryCommandBuffers: The render pass commands will be executed from secondary command buffers.
-
-            commandBuffers[index].bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline); // first parameter specifies if is a graphics or compute pipeline
-            commandBuffers[index].draw(3, 1, 0, 0);            
-            // vertexCount: Even though we don't have a vertex buffer, we technically still have 3 vertices to draw.
-            // instanceCount: Used for instanced rendering, use 1 if you're not doing that.
-            // firstVertex: Used as an offset into the vertex buffer, defines the lowest value of gl_VertexIndex.
-            // firstInstance: Used as an offset for instanced rendering, defines the lowest value of gl_InstanceIndex.
-
-            commandBuffers[index].endRenderPass();
-            commandBuffers[index].end();
+    void createSceneLayout() {
+        if (options.instanceCount > 0) {
+            scene.createSetLayout(device);
+        }
+    }
+
+    void createScene() {
+        if (options.instanceCount == 0) {
+            return;
+        }
+        bool multiDraw = enabledFeatures.multiDrawIndirect && enabledFeatures.drawIndirectFirstInstance;
+        auto cullShaderModule = loadShader("cull.comp.spv");
+        scene.init(allocator, uploads, options.instanceCount, multiDraw, cullShaderModule, pipelineCache.get());
+        device.destroyShaderModule(cullShaderModule);
+        std::cout << "Instanced scene: " << options.instanceCount << " instances, "
+                  << (multiDraw ? "one multi-draw indirect" : "one indirect draw per mesh") << std::endl;
+    }
+
+    // The file stays mapped for the lifetime of the application, device recreation uploads it again
+    void openMesh() {
+        if (options.meshPath.empty()) {
+            return;
+        }
+#ifdef __ANDROID__
+        meshFile = MeshFile::open(assets, options.meshPath);
+#else
+        // Command line paths are relative to the working directory, not to the asset root
+        meshFile = MeshFile::open(assets, std::filesystem::absolute(options.meshPath).string());
+#endif
+        const MeshFileHeader& header = meshFile.header();
+        std::cout << "Mesh: " << options.meshPath << ", " << header.vertexCount << " vertices in " << header.streamCount
+                  << " stream(s), " << header.indexCount << " indices, " << header.submeshCount << " submesh(es)" << std::endl;
+    }
+
+    // Creates the buffers and streams the file into them on a loader thread, frames draw it once the upload is acquired
+    void createMesh() {
+        if (!meshFile.isOpen()) {
+            return;
+        }
+        gpuMesh.create(allocator, meshFile);
+        meshReady = false;
+        meshTicket.store(0);
+        cancelMeshLoad.store(false);
+        meshLoader = std::thread([this] {
+            auto start = std::chrono::steady_clock::now();
+            try {
+                UploadTicket ticket = gpuMesh.upload(uploads, cancelMeshLoad);
+                if (ticket == 0) {
+                    return;
+                }
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                double megabytes = meshFile.asset().bytes().size() / double(1 << 20);
+                std::cout << "Mesh: streamed " << megabytes << " MB in " << seconds << "s ("
+                          << (megabytes / seconds) << " MB/s)" << std::endl;
+                meshTicket.store(ticket, std::memory_order_release);
+            } catch (const std::exception& e) {
+                std::cerr << "Mesh upload failed: " << e.what() << std::endl;
+            }
+        });
+    }
+
+    // Must run before the upload manager goes away, a load still in progress stops at its next piece
+    void stopMeshLoader() {
+        cancelMeshLoad.store(true);
+        if (meshLoader.joinable()) {
+            meshLoader.join();
         }
     }
 
+    // Orbits the mesh's bounding box, far enough to keep all of it in view. The lights stay fixed in world space.
+    void updateMeshCamera(uint64_t frame, float aspect) {
+        const MeshFileHeader& header = meshFile.header();
+        float center[3], radius = 0.0f;
+        for (int i = 0; i < 3; i++) {
+            center[i] = (header.boundsMin[i] + header.boundsMax[i]) * 0.5f;
+            float extent = header.boundsMax[i] - header.boundsMin[i];
+            radius += extent * extent;
+        }
+        radius = std::max(std::sqrt(radius) * 0.5f, 1e-3f);
+        float distance = radius * 2.5f;
+        float angle = float(frame % 3600) / 3600.0f * 6.2831853f;
+        float eye[3] = {center[0] + distance * std::cos(angle), center[1] + distance * 0.4f, center[2] + distance * std::sin(angle)};
+        float view[16], projection[16];
+        lookAt(eye, center, view);
+        perspective(1.0472f, aspect, distance * 0.01f, distance * 4.0f, projection);
+        multiply(projection, view, meshConstants.viewProjection);
+        std::copy(eye, eye + 3, meshConstants.eye);
+
+        // Key, fill and rim light, xyz towards the light and w its intensity
+        const float lights[k_meshLights][4] = {{0.4f, 0.8f, 0.5f, 0.8f}, {-0.6f, 0.3f, -0.4f, 0.3f}, {0.0f, -0.4f, -1.0f, 0.25f}};
+        for (uint32_t i = 0; i < k_meshLights; i++) {
+            std::copy(lights[i], lights[i] + 4, meshConstants.lights[i]);
+        }
+        meshConstants.ambient[0] = meshConstants.ambient[1] = meshConstants.ambient[2] = 0.15f;
+    }
+
+    void destroySimulation() {
+        asyncCompute.destroy();
+        simulationPipeline.destroy();
+        for (size_t slot = 0; slot < simulationBuffers.size(); slot++) {
+            allocator.destroyBuffer(simulationBuffers[slot], simulationAllocations[slot]);
+        }
+        simulationBuffers.clear();
+        simulationAllocations.clear();
+        simulationSets.clear();
+        for (auto handle : simulationHandles) {
+            bindless.free(BindlessTable::StorageBuffers, handle);
+        }
+        simulationHandles.clear();
+        device.destroyDescriptorPool(simulationDescriptorPool);
+        device.destroyDescriptorSetLayout(simulationSetLayout);
+    }
+
     void createSyncObjects() {
-        imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        inFlightFences.clear();
-        inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-        imagesInFlight.clear();
-        imagesInFlight.resize(swapChainImages.size(), nullptr);
+        // The swapchain still needs binary semaphores for acquire and present, one pair per frame slot
+        imageAvailableSemaphores.resize(framePacer.depth());
+        renderFinishedSemaphores.resize(framePacer.depth());
+        imageFrames.assign(swapChainImages.size(), 0);
         vk::SemaphoreCreateInfo semaphoreInfo{};
-        vk::FenceCreateInfo fenceInfo{};
-        fenceInfo.setFlags(vk::FenceCreateFlagBits::eSignaled);
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (size_t i = 0; i < framePacer.depth(); i++) {
             imageAvailableSemaphores[i] = device.createSemaphore(semaphoreInfo);
             renderFinishedSemaphores[i] = device.createSemaphore(semaphoreInfo);
-            inFlightFences[i] = device.createFence(fenceInfo);
         }
     }
 
-    static std::vector<char> readFile(const std::string& filename) {
+    void writeProfile() {
+        if (!options.tracePath.empty()) {
+            profiler.writeChromeTrace(options.tracePath);
+            std::cout << "Wrote Chrome trace to " << options.tracePath << std::endl;
+        }
+        if (!options.profileCsvPath.empty()) {
+            profiler.writePercentileCsv(options.profileCsvPath);
+            std::cout << "Wrote frame phase percentiles to " << options.profileCsvPath << std::endl;
+        }
+    }
+
+    void destroySyncObjects() {
+        for (size_t i = 0; i < imageAvailableSemaphores.size(); i++) {
+            device.destroySemaphore(renderFinishedSemaphores[i]);
+            device.destroySemaphore(imageAvailableSemaphores[i]);
+        }
+        imageAvailableSemaphores.clear();
+        renderFinishedSemaphores.clear();
+        framePacer.destroy();
+    }
+
+    // Resolves where assets come from once, every later open goes straight to the files
+    void initAssets() {
 #ifdef __ANDROID__
         JNIEnv* env = (JNIEnv*)SDL_AndroidGetJNIEnv();  // Pointer to native interface
-        jint ver = env->GetVersion();
         jobject activity = (jobject)SDL_AndroidGetActivity();
         jclass clazz(env->GetObjectClass(activity));
         jmethodID midGetContext = env->GetStaticMethodID(clazz, "getContext", "()Landroid/content/Context;");
         auto context = env->CallStaticObjectMethod(clazz, midGetContext);
-        auto mid = env->GetMethodID(env->GetObjectClass(context), "getAssets", "()Landroid/content/res/AssetManager;");
-        jobject ez = env->CallObjectMethod(context, mid);
-        
-        AAssetManager *assetManager = AAssetManager_fromJava(env, ez);
-        AAsset* asset = AAssetManager_open(assetManager, filename.c_str(), AASSET_MODE_STREAMING);
-        size_t size = AAsset_getLength(asset);
-        std::vector<char> buffer(size);
-        AAsset_read(asset, buffer.data(), size);
-        AAsset_close(asset);
-        return buffer;
+        jclass contextClass = env->GetObjectClass(context);
+        auto mid = env->GetMethodID(contextClass, "getAssets", "()Landroid/content/res/AssetManager;");
+        jobject assetManager = env->CallObjectMethod(context, mid);
+        // The native manager is only valid while the Java AssetManager is alive, hold on to it for the whole run
+        assetManagerRef = env->NewGlobalRef(assetManager);
+        env->DeleteLocalRef(assetManager);
+        env->DeleteLocalRef(contextClass);
+        env->DeleteLocalRef(context);
+        env->DeleteLocalRef(clazz);
+        env->DeleteLocalRef(activity);
+        assets.init(AAssetManager_fromJava(env, assetManagerRef));
+#elif defined(NARU_EMBED_SHADERS)
+        // Shaders are compiled in, the remaining assets are given on the command line relative to the working directory
+        assets.init("");
 #else
-        std::ifstream file(filename, std::ios::ate | std::ios::binary);
-            
-        if (!file.is_open()) {
-            throw std::runtime_error("failed to open file!");
-        }
-
-        size_t fileSize = (size_t) file.tellg();
-        std::vector<char> buffer(fileSize);
-
-        file.seekg(0);
-        file.read(buffer.data(), fileSize);
-        file.close();
-        return buffer;
+        assets.init(getExecutablePath());
 #endif
     }
 
-    static std::string getShaderPath() {
-#if defined(__ANDROID__)
-        return "shaders";
+    vk::ShaderModule loadShader(const std::string& name) {
+#ifdef NARU_EMBED_SHADERS
+        auto code = embedded_shaders::find(name);
+        if (code.empty()) {
+            throw std::runtime_error("shader " + name + " was not embedded!");
+        }
+        return createShaderModule(std::as_bytes(code));
 #else
-        return getExecutablePath() + "/shaders";
+        // Preloaded files are only used once, hot reloads have to see the new contents
+        Asset code;
+        {
+            std::lock_guard<std::mutex> lock(preloadedShadersMutex);
+            auto preloaded = preloadedShaders.find(name);
+            if (preloaded != preloadedShaders.end()) {
+                code = std::move(preloaded->second);
+                preloadedShaders.erase(preloaded);
+            }
+        }
+        if (!code.isOpen()) {
+            code = assets.open("shaders/" + name);
+        }
+        return createShaderModule(code.bytes());
+#endif
+    }
+
+    // Opens the shaders the startup pipelines need and touches every page, so the pipeline builders do not
+    // wait on the disk. Only a cold start profits, a missing file is reported once loadShader() needs it.
+    void preloadShaders() {
+#ifndef NARU_EMBED_SHADERS
+        std::vector<std::string> names = {"shader.vert.spv", "bindless.vert.spv", "shader.frag.spv", "simulate.comp.spv"};
+        if (options.instanceCount > 0) {
+            names.insert(names.end(), {"instanced.vert.spv", "cull.comp.spv"});
+        }
+        if (!options.meshPath.empty()) {
+            names.insert(names.end(), {"mesh.vert.spv", "mesh.frag.spv"});
+        }
+        for (const auto& name : names) {
+            Asset code;
+            try {
+                code = assets.open("shaders/" + name);
+            } catch (const std::exception&) {
+                continue;
+            }
+            auto bytes = code.bytes();
+            for (size_t offset = 0; offset < bytes.size(); offset += 4096) {
+                static_cast<void>(*reinterpret_cast<const volatile std::byte*>(bytes.data() + offset));
+            }
+            std::lock_guard<std::mutex> lock(preloadedShadersMutex);
+            preloadedShaders.emplace(name, std::move(code));
+        }
 #endif
     }
 
@@ -655,7 +1415,7 @@ private:
         std::call_once(once, []{
             char result[PATH_MAX];
             ssize_t count = readlink("/proc/self/exe", result, PATH_MAX);
-            return std::string execPath(result, (count > 0) ? count : 0);
+            std::string execPath(result, (count > 0) ? count : 0);
             std::replace(execPath.begin(), execPath.end(), '\\', '/');
             std::string::size_type lastSlash = execPath.rfind("/");
             path = execPath.substr(0, lastSlash);
@@ -669,10 +1429,28 @@ private:
 #endif
     }
 
-    vk::ShaderModule createShaderModule(const std::vector<char>& code) {
+    vk::ShaderModule createShaderModule(std::span<const std::byte> code) {
+        // Cheap guard against truncated or foreign files, a hot reload may pick up anything written to the directory
+        constexpr uint32_t spirvMagic = 0x07230203;
+        if (code.size() < 20 || code.size() % 4 != 0) {
+            throw std::runtime_error("invalid SPIR-V module!");
+        }
+        uint32_t magic;
+        memcpy(&magic, code.data(), sizeof(magic));
+        if (magic != spirvMagic) {
+            throw std::runtime_error("invalid SPIR-V module!");
+        }
         vk::ShaderModuleCreateInfo createInfo{};
         createInfo.codeSize = code.size();
-        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        // Mapped files are page aligned and APK assets are zipaligned, only a stray packaging needs the copy
+        std::vector<uint32_t> aligned;
+        if (reinterpret_cast<uintptr_t>(code.data()) % alignof(uint32_t) != 0) {
+            aligned.resize((code.size() + 3) / 4);
+            memcpy(aligned.data(), code.data(), code.size());
+            createInfo.pCode = aligned.data();
+        } else {
+            createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+        }
         return device.createShaderModule(createInfo);
     }
 
@@ -687,11 +1465,18 @@ private:
         return score;
     }
 
-    void initWindow() {
+    void initSdl() {
         if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS) != 0) {
 		    std::cerr << "Failed to initialize SDL:" << SDL_GetError() << std::endl;
             throw std::runtime_error("Failed to initialize SDL!");
 	    }
+        // SDL only reports the instance extensions once it has loaded Vulkan, which otherwise happens when the window is created
+        if (SDL_Vulkan_LoadLibrary(nullptr) != 0) {
+            throw std::runtime_error(std::string("failed to load Vulkan through SDL: ") + SDL_GetError() + "!");
+        }
+    }
+
+    void initWindow() {
         window = SDL_CreateWindow(
             "A Simple Triangle",
             SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
@@ -702,82 +1487,377 @@ private:
 #else
         SDL_SetWindowFullscreen(window, SDL_FALSE);
 #endif
-
+        int width = 0, height = 0;
+        SDL_Vulkan_GetDrawableSize(window, &width, &height);
+        windowExtent = vk::Extent2D(width, height);
     }
 
+    // Window events and input, sent from the event thread to the render thread
+    struct RenderMessage {
+        enum class Type { Resize, Minimize, Restore, Key, DeviceReset, Quit } type;
+        vk::Extent2D extent{}; // Resize: the new drawable size
+        SDL_Keycode key = SDLK_UNKNOWN;
+        vk::SurfaceKHR surface{}; // DeviceReset: created by the event thread, null if SDL failed to
+    };
+
     void onWindowResize() {
         framebufferResized = true;
     }
 
-    void mainLoop() {
-        while (true) {
-            SDL_Event event;
-            // Each loop we will process any events that are waiting for us.
-            bool quit = false;
-            while (SDL_PollEvent(&event)) {
-                switch (event.type) {
-                    case SDL_WINDOWEVENT:
-                        onWindowResize();
-                        break;
-                    case SDL_RENDER_DEVICE_RESET:
-                        recreateVulkanStructures();
-                        break;
+    // Render thread. A minimized window reports a 0x0 drawable on some platforms, no swapchain can be created for it.
+    bool isMinimized() const {
+        return windowMinimized || windowExtent.width == 0 || windowExtent.height == 0;
+    }
 
-                    case SDL_QUIT:
-                        quit = true;
+    // Render thread. In on-demand mode, whether the next frame would differ from the one on screen.
+    bool needsRedraw() {
+        return redrawRequested || framebufferResized || pipelineRegistry.pending() > 0 || (meshFile.isOpen() && !meshReady);
+    }
 
-                    case SDL_KEYDOWN:
-                        if (event.key.keysym.sym == SDLK_ESCAPE) {
-                            quit = true;
-                        }
+    // Event thread. Translates the SDL events the renderer cares about into messages, returns true when the application should quit.
+    bool handleEvent(const SDL_Event& event) {
+        switch (event.type) {
+            case SDL_WINDOWEVENT:
+                // Focus, enter, leave and move events change nothing that is rendered
+                switch (event.window.event) {
+                    case SDL_WINDOWEVENT_SIZE_CHANGED: {
+                        int width = 0, height = 0;
+                        SDL_Vulkan_GetDrawableSize(window, &width, &height);
+                        postRenderMessage({RenderMessage::Type::Resize, vk::Extent2D(width, height)});
+                        break;
+                    }
+                    case SDL_WINDOWEVENT_MINIMIZED:
+                    case SDL_WINDOWEVENT_HIDDEN:
+                        postRenderMessage({RenderMessage::Type::Minimize});
+                        break;
+                    case SDL_WINDOWEVENT_SHOWN:
+                    case SDL_WINDOWEVENT_EXPOSED:
+                    case SDL_WINDOWEVENT_RESTORED:
+                        postRenderMessage({RenderMessage::Type::Restore});
                         break;
                     default:
                         break;
                 }
+                return false;
+            case SDL_RENDER_DEVICE_RESET: {
+                // SDL video calls stay on the event thread, the render thread only gets the new surface
+                VkSurfaceKHR newSurface = VK_NULL_HANDLE;
+                SDL_Vulkan_CreateSurface(window, instance, &newSurface);
+                postRenderMessage({RenderMessage::Type::DeviceReset, {}, SDLK_UNKNOWN, vk::SurfaceKHR(newSurface)});
+                return false;
             }
-            if (quit) {
-                break;
+            case SDL_QUIT:
+                return true;
+            case SDL_KEYDOWN:
+                if (event.key.keysym.sym == SDLK_ESCAPE) {
+                    return true;
+                }
+                postRenderMessage({RenderMessage::Type::Key, {}, event.key.keysym.sym});
+                return false;
+            default:
+                return false;
+        }
+    }
+
+    // Event thread
+    void postRenderMessage(const RenderMessage& message) {
+        // The render thread drains the queue before every frame, it only fills up while a frame blocks for long.
+        // Once it has stopped nobody ever will, the message is dropped and the SDL_QUIT it posted gets through.
+        while (!renderMessages.push(message)) {
+            if (!renderThreadRunning.load(std::memory_order_acquire)) {
+                return;
+            }
+            std::this_thread::yield();
+        }
+        // Taking the mutex orders the push before the check of a render thread that is about to sleep, the wakeup cannot get lost
+        { std::lock_guard<std::mutex> lock(renderWakeMutex); }
+        renderWake.notify_one();
+    }
+
+    // Render thread. Applies every pending message, returns false once the event thread asked to quit.
+    bool processRenderMessages() {
+        RenderMessage message;
+        while (renderMessages.pop(message)) {
+            switch (message.type) {
+                case RenderMessage::Type::Resize:
+                    windowExtent = message.extent;
+                    onWindowResize();
+                    break;
+                case RenderMessage::Type::Minimize:
+                    windowMinimized = true;
+                    break;
+                case RenderMessage::Type::Restore:
+                    windowMinimized = false;
+                    redrawRequested = true;
+                    break;
+                case RenderMessage::Type::Key:
+                    if (message.key == SDLK_m) {
+                        cycleSampleCount();
+                    }
+                    redrawRequested = true;
+                    break;
+                case RenderMessage::Type::DeviceReset:
+                    recreateVulkanStructures(message.surface);
+                    redrawRequested = true;
+                    break;
+                case RenderMessage::Type::Quit:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    // The event thread only waits for SDL events and forwards them, a frame blocking on a fence or in
+    // acquireNextImageKHR never delays input handling and slow event handling never delays a submit
+    void mainLoop() {
+        std::exception_ptr renderError;
+        renderThreadRunning.store(true, std::memory_order_release);
+        // Vulkan belongs to the render thread from here on, until it has been joined
+        std::thread renderThread([this, &renderError] {
+            try {
+                renderLoop();
+            } catch (...) {
+                renderError = std::current_exception();
+                renderThreadRunning.store(false, std::memory_order_release);
+                // Wakes the event thread, which then stops waiting for events. SDL_PushEvent is thread-safe, it is the
+                // only SDL call the render thread makes.
+                SDL_Event quitEvent{};
+                quitEvent.type = SDL_QUIT;
+                SDL_PushEvent(&quitEvent);
+            }
+        });
+        bool quit = false;
+        while (!quit) {
+            SDL_Event event;
+            if (SDL_WaitEvent(&event)) {
+                quit = handleEvent(event);
+            }
+        }
+        postRenderMessage({RenderMessage::Type::Quit});
+        renderThread.join();
+        if (renderError) {
+            std::rethrow_exception(renderError);
+        }
+        device.waitIdle();
+        if (idleWaits > 0) {
+            std::cout << "Idle: " << idleSeconds << "s waiting for events in " << idleWaits << " wait(s), "
+                      << presentedFrames << " frames drawn" << std::endl;
+        }
+        if (presentedFrames > 0) {
+            std::cout << "Acquire to present (" << presentPolicyName(options.presentPolicy) << "): "
+                      << (presentLatencySeconds * 1e3 / presentedFrames) << " ms on average, "
+                      << (presentLatencyMaxSeconds * 1e3) << " ms max over " << presentedFrames << " frames" << std::endl;
+        }
+        if (swapchainRecreations > 0) {
+            std::cout << "Swapchain recreated " << swapchainRecreations << " times, "
+                      << (swapchainRecreateSeconds * 1e3 / swapchainRecreations) << " ms on average" << std::endl;
+        }
+    }
+
+    void renderLoop() {
+        while (processRenderMessages()) {
+            bool minimized = isMinimized();
+            if (minimized || (options.onDemand && !needsRedraw())) {
+                // Nothing to draw: sleeps until the next message, while minimized without a timeout since only an
+                // event can make the window visible again
+                auto idleStart = std::chrono::steady_clock::now();
+                std::unique_lock<std::mutex> lock(renderWakeMutex);
+                auto hasMessage = [this] { return !renderMessages.empty(); };
+                if (minimized) {
+                    renderWake.wait(lock, hasMessage);
+                } else {
+                    renderWake.wait_for(lock, std::chrono::milliseconds(k_idleTimeoutMs), hasMessage);
+                }
+                lock.unlock();
+                idleSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - idleStart).count();
+                idleWaits++;
+                // Finishes pipeline builds and picks up shader changes without drawing
+                updatePipelines();
+                continue;
             }
+            redrawRequested = false;
+            drawFrame();
+        }
+    }
+
+    void headlessLoop() {
+        using clock = std::chrono::steady_clock;
+        // Every frame of the benchmark must draw the full workload
+        waitForPipelines();
+        auto start = clock::now();
+        for (uint32_t frame = 0; frame < options.frameCount; frame++) {
             drawFrame();
         }
         device.waitIdle();
+        double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+        uint32_t frames = std::max(options.frameCount, 1u);
+        std::cout << "Headless " << swapChainExtent.width << "x" << swapChainExtent.height << ": "
+                  << options.frameCount << " frames in " << seconds << "s, "
+                  << (options.frameCount / seconds) << " fps, "
+                  << (submitSeconds * 1e6 / frames) << " us CPU submit per frame";
+        if (options.instanceCount > 0) {
+            std::cout << ", " << options.instanceCount << " instances";
+        }
+        std::cout << std::endl;
+
+        if (!options.dumpPath.empty()) {
+            writePpm(options.dumpPath, readbackFrame());
+        }
     }
 
-    void drawFrame() {
-        device.waitForFences(1, &inFlightFences[currentFrame], true, UINT64_MAX);
-        uint32_t imageIndex;
+    // Copies the last rendered headless frame into host memory as tightly packed RGBA8 rows.
+    std::vector<uint8_t> readbackFrame() {
+        device.waitIdle();
+        vk::DeviceSize size = vk::DeviceSize(swapChainExtent.width) * swapChainExtent.height * 4;
 
-        if (framebufferResized)
-            recreateSwapChain();
-        // acquireNextImageKHR will signal semaphore when complete
-        auto result = device.acquireNextImageKHR(swapchain, UINT64_MAX, imageAvailableSemaphores[currentFrame], nullptr);
-        if (result.result == vk::Result::eErrorOutOfDateKHR) {
-            recreateSwapChain();
-            return;
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.setSize(size)
+            .setUsage(vk::BufferUsageFlagBits::eTransferDst)
+            .setSharingMode(vk::SharingMode::eExclusive);
+        Allocation readbackAllocation;
+        vk::Buffer readbackBuffer = allocator.createBuffer(bufferInfo, MemoryUsage::GpuToCpu, readbackAllocation);
+
+        vk::CommandBufferAllocateInfo commandBufferInfo{};
+        commandBufferInfo.setCommandPool(commandPool)
+            .setLevel(vk::CommandBufferLevel::ePrimary)
+            .setCommandBufferCount(1);
+        vk::CommandBuffer commandBuffer = device.allocateCommandBuffers(commandBufferInfo)[0];
+        commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+        vk::BufferImageCopy region{};
+        region.setBufferOffset(0)
+            .setBufferRowLength(0) // 0 means tightly packed according to the image extent
+            .setBufferImageHeight(0)
+            .setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1})
+            .setImageOffset({0, 0, 0})
+            .setImageExtent({swapChainExtent.width, swapChainExtent.height, 1});
+        // The render graph already left the image in eTransferSrcOptimal
+        commandBuffer.copyImageToBuffer(offscreenImage, vk::ImageLayout::eTransferSrcOptimal, readbackBuffer, 1, &region);
+        commandBuffer.end();
+
+        vk::SubmitInfo submitInfo{};
+        submitInfo.setCommandBufferCount(1)
+            .setPCommandBuffers(&commandBuffer);
+        {
+            std::lock_guard<std::mutex> queueLock(graphicsQueueMutex);
+            graphicsQueue.submit(1, &submitInfo, nullptr);
+            graphicsQueue.waitIdle();
         }
-        imageIndex = result.value;
-        // Check if a previous frame is using this image (i.e. there is its fence to wait on)
-        if (imagesInFlight[imageIndex]) {
-            device.waitForFences(1, &imagesInFlight[imageIndex], true, UINT64_MAX);
+
+        std::vector<uint8_t> pixels(size);
+        if (!readbackAllocation.coherent) {
+            // Cached but non-coherent memory has to be invalidated before the CPU sees the GPU writes
+            device.invalidateMappedMemoryRanges(vk::MappedMemoryRange(readbackAllocation.memory, 0, VK_WHOLE_SIZE));
+        }
+        memcpy(pixels.data(), readbackAllocation.mapped, size);
+
+        device.freeCommandBuffers(commandPool, commandBuffer);
+        allocator.destroyBuffer(readbackBuffer, readbackAllocation);
+        return pixels;
+    }
+
+    void writePpm(const std::string& path, const std::vector<uint8_t>& rgba) {
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open " + path + " for writing!");
+        }
+        file << "P6\n" << swapChainExtent.width << " " << swapChainExtent.height << "\n255\n";
+        for (size_t i = 0; i < rgba.size(); i += 4) {
+            file.write(reinterpret_cast<const char*>(&rgba[i]), 3); // PPM has no alpha channel
+        }
+    }
+
+    void drawFrame() {
+        {
+            // Before anything of the frame happens, so its input is sampled as late as possible
+            ProfileScope scope(profiler, "limiter");
+            frameLimiter.wait();
+        }
+        ProfileScope frameScope(profiler, "frame");
+        profiler.setFrame(framePacer.currentFrame());
+        uint32_t frameSlot;
+        {
+            ProfileScope scope(profiler, "fence wait");
+            frameSlot = framePacer.beginFrame(); // blocks until the GPU is done with this slot's previous frame
+        }
+        releaseRetiredSwapchains();
+        updatePipelines();
+        // Descriptors added since the previous frame are written in one batch, before anything is recorded
+        bindless.flush();
+        uniformRing.beginFrame(frameSlot);
+        uint32_t imageIndex = 0; // headless mode renders to its single offscreen image
+        uint64_t acquireStartNs = Profiler::now();
+
+        if (!options.headless) {
+            if (framebufferResized) {
+                framebufferResized = false;
+                recreateSwapChain();
+            }
+            ProfileScope scope(profiler, "acquire");
+            // acquireNextImageKHR will signal semaphore when complete
+            vk::ResultValue<uint32_t> result(vk::Result::eErrorOutOfDateKHR, 0);
+            try {
+                result = device.acquireNextImageKHR(swapchain, UINT64_MAX, imageAvailableSemaphores[frameSlot], nullptr);
+            } catch (const vk::OutOfDateKHRError&) {
+                // vulkan-hpp reports eErrorOutOfDateKHR as an exception, handled like the result code below
+            }
+            if (result.result == vk::Result::eErrorOutOfDateKHR) {
+                recreateSwapChain();
+                return;
+            }
+            imageIndex = result.value;
+        }
+        {
+            ProfileScope scope(profiler, "image wait");
+            // Check if a previous frame is still rendering to this image, returns immediately if that frame is complete
+            framePacer.waitForFrame(imageFrames[imageIndex]);
         }
         // Mark the image as now being in use by this frame
-        imagesInFlight[imageIndex] = inFlightFences[currentFrame];
+        imageFrames[imageIndex] = framePacer.currentFrame();
+        {
+            ProfileScope scope(profiler, "record");
+            recordFrame(frameCommands[frameSlot], frameSlot, imageIndex);
+            // Everything the recording threads wrote into the ring goes out with a single flush
+            uniformRing.flush();
+        }
         vk::SubmitInfo submitInfo{};
-        vk::Semaphore waitSemaphores[] = {imageAvailableSemaphores[currentFrame]};
-        vk::PipelineStageFlags waitStages(vk::PipelineStageFlagBits::eColorAttachmentOutput);
         // Specify which semaphores to wait on before execution begins and in which stage(s) of the pipeline to wait
-        vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[currentFrame]};
-        submitInfo.setWaitSemaphoreCount(1)
-            .setPWaitSemaphores(waitSemaphores)
-            .setPWaitDstStageMask(&waitStages)
+        // Nothing acquires or presents in headless mode, so only the uploads are waited on there
+        std::vector<vk::Semaphore> waitSemaphores = frameCommands[frameSlot].uploadWaits;
+        std::vector<vk::PipelineStageFlags> waitStages = frameCommands[frameSlot].uploadWaitStages;
+        if (!options.headless) {
+            waitSemaphores.push_back(imageAvailableSemaphores[frameSlot]);
+            waitStages.push_back(vk::PipelineStageFlagBits::eColorAttachmentOutput);
+        }
+        // The instanced scene and the mesh draw no triangles, so nothing reads the simulation output
+        if (options.instanceCount == 0 && !meshFile.isOpen()) {
+            ProfileScope scope(profiler, "compute");
+            // Only the vertex shaders wait for the simulation, earlier stages of this frame can already start
+            waitSemaphores.push_back(submitSimulation(frameSlot));
+            waitStages.push_back(vk::PipelineStageFlagBits::eVertexShader);
+        }
+        vk::Semaphore signalSemaphores[] = {renderFinishedSemaphores[frameSlot]};
+        uint32_t semaphoreCount = options.headless ? 0 : 1;
+        submitInfo.setWaitSemaphoreCount(static_cast<uint32_t>(waitSemaphores.size()))
+            .setPWaitSemaphores(waitSemaphores.data())
+            .setPWaitDstStageMask(waitStages.data())
             .setCommandBufferCount(1)
-            .setPCommandBuffers(&commandBuffers[imageIndex])
-            .setSignalSemaphoreCount(1)
+            .setPCommandBuffers(&frameCommands[frameSlot].primary)
+            .setSignalSemaphoreCount(semaphoreCount)
             .setPSignalSemaphores(signalSemaphores);
 
-        device.resetFences(1, &inFlightFences[currentFrame]);
+        {
+            ProfileScope scope(profiler, "submit");
+            auto submitStart = std::chrono::steady_clock::now();
+            profiler.gpuFrameSubmitted(frameSlot, framePacer.currentFrame());
+            std::lock_guard<std::mutex> queueLock(graphicsQueueMutex);
+            framePacer.submit(graphicsQueue, submitInfo);
+            submitSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - submitStart).count();
+        }
 
-        graphicsQueue.submit(1, &submitInfo, inFlightFences[currentFrame]);
+        if (options.headless) {
+            return;
+        }
 
         vk::SwapchainKHR swapChains[] = {swapchain};
         vk::PresentInfoKHR presentInfo{};
@@ -788,34 +1868,86 @@ private:
             .setPImageIndices(&imageIndex)
             .setPResults(nullptr); // only relevant for multiple swapchains
 
-        auto presentResult = presentQueue.presentKHR(&presentInfo);
-        if (presentResult == vk::Result::eErrorOutOfDateKHR || presentResult == vk::Result::eSuboptimalKHR || framebufferResized) {
+        vk::Result presentResult;
+        {
+            ProfileScope scope(profiler, "present");
+            std::lock_guard<std::mutex> queueLock(graphicsQueueMutex);
+            presentResult = presentQueue.presentKHR(&presentInfo);
+        }
+        // CPU side of the frame's latency: how long the image was held between asking for it and queueing it for display
+        uint64_t presentNs = Profiler::now();
+        if (profiler.isEnabled()) {
+            profiler.recordCpu("acquire to present", acquireStartNs, presentNs);
+        }
+        double latencySeconds = (presentNs - acquireStartNs) * 1e-9;
+        presentLatencySeconds += latencySeconds;
+        presentLatencyMaxSeconds = std::max(presentLatencyMaxSeconds, latencySeconds);
+        presentedFrames++;
+        if (presentResult == vk::Result::eErrorOutOfDateKHR || presentResult == vk::Result::eSuboptimalKHR) {
             framebufferResized = false;
             recreateSwapChain();
-            return;
         }
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
     }
 
     void recreateSwapChain() {
-        int width = 0, height = 0;
-        SDL_GetWindowSize(window, &width, &height);
-        device.waitIdle();
+        auto start = std::chrono::steady_clock::now();
 
-        cleanupSwapChain();
+        vk::Format previousFormat = swapChainImageFormat;
+        retireSwapChain();
 
-        createSwapChain();
+        createSwapChain(retiredSwapchains.back().swapchain);
         createImageViews();
-        createRenderPass();
-        createGraphicsPipeline();
-        createFramebuffers();
-        createCommandBuffers();
+        // The render graph and pipelines only depend on the surface format, the extent is dynamic state
+        if (swapChainImageFormat != previousFormat) {
+            // Frames in flight still reference the old render pass and pipeline, this is the only path that has to drain the GPU
+            device.waitIdle();
+            cleanupPipeline();
+            createRenderGraph();
+            createGraphicsPipeline();
+        }
+        createGraphAttachments();
+        imageFrames.assign(swapChainImages.size(), 0);
+
+        swapchainRecreations++;
+        swapchainRecreateSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
     }
 
-    void createInstance() {
-#ifndef __ANDROID__
-        vk::DynamicLoader dl;
-        PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
+    // Moves the current swapchain and everything created from its images to the retirement list,
+    // they stay alive until the frames that were submitted against them have finished on the GPU.
+    void retireSwapChain() {
+        RetiredSwapchain retired{};
+        retired.swapchain = swapchain;
+        retired.imageViews = std::move(swapChainImageViews);
+        retired.attachments = std::move(graphAttachments);
+        // The fences only cover the submissions, not the presentation of the last images.
+        // Waiting for one full ring of frames on the new swapchain gives those presents time to be consumed.
+        retired.releaseFrame = framePacer.lastSubmittedFrame() + framePacer.depth();
+        retiredSwapchains.push_back(std::move(retired));
+        swapchain = nullptr;
+        swapChainImageViews.clear();
+        graphAttachments = {};
+    }
+
+    void releaseRetiredSwapchains(bool force = false) {
+        while (!retiredSwapchains.empty() && (force || framePacer.frameCompleted(retiredSwapchains.front().releaseFrame))) {
+            auto& retired = retiredSwapchains.front();
+            renderGraph.destroyAttachments(retired.attachments);
+            for (auto imageView : retired.imageViews) {
+                device.destroyImageView(imageView);
+            }
+            device.destroySwapchainKHR(retired.swapchain);
+            retiredSwapchains.pop_front();
+        }
+    }
+
+    void createInstance(const std::vector<const char*>& extensions) {
+#ifdef __ANDROID__
+        // Dynamically loads the Vulkan library and seeds the function pointer mapping
+        if (!InitVulkan()) {
+            throw std::runtime_error("failed to load Vulkan!");
+        }
+#else
+        PFN_vkGetInstanceProcAddr vkGetInstanceProcAddr = dynamicLoader.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
         VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
 #endif
 #ifdef DEBUG
@@ -824,7 +1956,6 @@ private:
         }
 #endif
         const vk::ApplicationInfo appInfo = getApplicationInfo();
-        auto extensions = getRequiredExtensions();
         vk::InstanceCreateInfo createInfo(vk::InstanceCreateFlags(), 
                                           &appInfo,
 #ifdef DEBUG
@@ -862,34 +1993,44 @@ private:
 #endif
 
     vk::ApplicationInfo getApplicationInfo() {
-        return vk::ApplicationInfo("Hello Triangle", VK_MAKE_VERSION(1, 0, 0), "No Engine", VK_MAKE_VERSION(1, 0, 0), VK_API_VERSION_1_0);
+        // Ask for Vulkan 1.2 when the loader has it (timeline semaphores), everything else keeps working on 1.0
+        instanceApiVersion = std::min(getInstanceApiVersion(), static_cast<uint32_t>(VK_API_VERSION_1_2));
+        return vk::ApplicationInfo("Hello Triangle", VK_MAKE_VERSION(1, 0, 0), "No Engine", VK_MAKE_VERSION(1, 0, 0), instanceApiVersion);
+    }
+
+    uint32_t getInstanceApiVersion() {
+        // vkEnumerateInstanceVersion does not exist in Vulkan 1.0 loaders
+#ifdef __ANDROID__
+        if (!vkEnumerateInstanceVersion) {
+#else
+        if (!VULKAN_HPP_DEFAULT_DISPATCHER.vkEnumerateInstanceVersion) {
+#endif
+            return VK_API_VERSION_1_0;
+        }
+        return vk::enumerateInstanceVersion();
     }
 
     std::vector<const char*> getRequiredExtensions() {
-        uint32_t extensionCount = 0;
-        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
-        std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-        vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
-            
-        uint32_t sdlExtensionCount;
+        if (options.headless) {
+            // Rendering offscreen needs no surface extensions, and SDL's video subsystem is never initialized
+#ifdef DEBUG
+            return {VK_EXT_DEBUG_UTILS_EXTENSION_NAME};
+#else
+            return {};
+#endif
+        }
+        // Only what the surface needs, enumerating and printing every extension the loader offers costs startup time
+        uint32_t sdlExtensionCount = 0;
         SDL_Vulkan_GetInstanceExtensions(nullptr, &sdlExtensionCount, nullptr);
-
-        auto sdlExtensionNames{std::make_unique<const char**>(new const char*[sdlExtensionCount])};
-        SDL_Vulkan_GetInstanceExtensions(nullptr, &sdlExtensionCount, *sdlExtensionNames);
-        std::vector<const char*> sdlExtensions(*sdlExtensionNames, *sdlExtensionNames + sdlExtensionCount);
-
-
-        std::cout << "Extensions:" << sdlExtensionCount << std::endl;
-        for (const auto& extension : availableExtensions) {
-            bool enabled = false;
-            for (auto i = 0u; i < sdlExtensionCount; ++i) {
-                if (!strcmp(extension.extensionName, (*sdlExtensionNames)[i])) {
-                    enabled = true;
-                    break;
-                }
-            }
-            std::cout << "\t" << ((enabled) ? " [X] " : " [ ] ") << extension.extensionName << std::endl;
+        std::vector<const char*> sdlExtensions(sdlExtensionCount);
+        if (!SDL_Vulkan_GetInstanceExtensions(nullptr, &sdlExtensionCount, sdlExtensions.data())) {
+            throw std::runtime_error(std::string("failed to query the instance extensions SDL needs: ") + SDL_GetError() + "!");
         }
+        std::cout << "Instance extensions:";
+        for (const char* name : sdlExtensions) {
+            std::cout << ' ' << name;
+        }
+        std::cout << '\n';
 #ifdef DEBUG
         sdlExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 #endif
@@ -897,104 +2038,347 @@ private:
     }
 
     void cleanup() {
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            device.destroySemaphore(renderFinishedSemaphores[i]);
-            device.destroySemaphore(imageAvailableSemaphores[i]);
-            device.destroyFence(inFlightFences[i]);
-        }
+        stopMeshLoader();
+#ifndef NARU_EMBED_SHADERS
+        preloadedShaders.clear(); // the ones no pipeline asked for, Android assets must close before the asset manager goes away
+#endif
+        shaderWatcher.stop();
+        uploads.destroy();
+        destroySyncObjects();
+        profiler.destroyGpu();
         cleanupSwapChain();
+        cleanupPipeline();
+        destroySimulation();
+        uniformRing.destroy();
+        scene.destroy();
+        gpuMesh.destroy();
+        if (options.headless) {
+            allocator.destroyImage(offscreenImage, offscreenAllocation);
+        }
+        destroyFrameCommands();
         device.destroyCommandPool(commandPool);
+        destroyPipelineCache();
+        bindless.destroy();
+        allocator.printStats(std::cout);
+        allocator.destroy();
         instance.destroySurfaceKHR(surface);
         device.destroy();
 #ifdef DEBUG
         instance.destroyDebugUtilsMessengerEXT(debugMessenger);
 #endif
         instance.destroy();
-        SDL_DestroyWindow(window);
+        if (window) {
+            SDL_DestroyWindow(window);
+            SDL_Vulkan_UnloadLibrary(); // the reference taken by initSdl()
+        }
+#ifdef __ANDROID__
+        ((JNIEnv*)SDL_AndroidGetJNIEnv())->DeleteGlobalRef(assetManagerRef);
+#endif
         SDL_Quit();
     }
 
-    void recreateVulkanStructures() {
+    // Render thread. newSurface comes from the event thread, so nothing here calls into SDL.
+    void recreateVulkanStructures(vk::SurfaceKHR newSurface) {
+        stopMeshLoader();
         device.waitIdle();
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            device.destroySemaphore(renderFinishedSemaphores[i]);
-            device.destroySemaphore(imageAvailableSemaphores[i]);
-            device.destroyFence(inFlightFences[i]);
-        }
+        uploads.destroy();
+        destroySyncObjects();
+        profiler.destroyGpu();
         cleanupSwapChain();
+        cleanupPipeline();
+        destroySimulation();
+        uniformRing.destroy();
+        scene.destroy();
+        gpuMesh.destroy();
+        destroyFrameCommands();
         device.destroyCommandPool(commandPool);
+        destroyPipelineCache();
+        bindless.destroy();
+        allocator.destroy();
         instance.destroySurfaceKHR(surface);
         device.destroy();
 
-        createSurface();
+        if (!newSurface) {
+            throw std::runtime_error("SDL could not create a Vulkan surface.");
+        }
+        surface = newSurface;
         pickPhysicalDevice();
         createLogicalDevice();
+        allocator.init(physicalDevice, device);
+        createBindlessTable();
+        loadPipelineCache();
         createSwapChain();
         createImageViews();
-        createRenderPass();
+        createRenderGraph();
+        createSimulationLayout();
+        createSceneLayout();
+        uniformRing.createSetLayout(device);
         createGraphicsPipeline();
-        createFramebuffers();
+        createGraphAttachments();
         createCommandPool();
-        createCommandBuffers();
+        createFramePacer();
+        createUploadManager();
+        createUniformRing();
+        createSimulation();
+        createScene();
+        createMesh();
+        profiler.initGpu(device, physicalDevice, findQueueFamilies(physicalDevice).graphicsFamily.value(), framePacer.depth());
+        createFrameCommands();
         createSyncObjects();
     }
     
+    // Must only be called once the device is idle
     void cleanupSwapChain() {
-        for (auto framebuffer : swapChainFramebuffers) {
-            device.destroyFramebuffer(framebuffer);
-        }
-        device.freeCommandBuffers(commandPool, commandBuffers);
-        device.destroyPipeline(graphicsPipeline);
-        device.destroyPipelineLayout(pipelineLayout);
-        device.destroyRenderPass(renderPass);
+        releaseRetiredSwapchains(true);
+        renderGraph.destroyAttachments(graphAttachments);
         for (auto imageView : swapChainImageViews) {
             device.destroyImageView(imageView);
         }
         device.destroySwapchainKHR(swapchain);
     }
+
+    void cleanupPipeline() {
+        // The registry owns the pipelines and resets the members pointing at them
+        dropPendingPipelines();
+        device.destroyPipelineLayout(pipelineLayout);
+        if (scenePipelineLayout) {
+            device.destroyPipelineLayout(scenePipelineLayout);
+            scenePipelineLayout = nullptr;
+        }
+        if (meshPipelineLayout) {
+            device.destroyPipelineLayout(meshPipelineLayout);
+            meshPipelineLayout = nullptr;
+        }
+        renderGraph.destroy();
+        renderPass = nullptr;
+    }
     
-    SDL_Window* window;
+    AppOptions options;
+    SDL_Window* window = nullptr;
 
+#ifndef __ANDROID__
+    // Keeps the Vulkan loader loaded for the lifetime of the application, SDL does not load it in headless mode
+    vk::DynamicLoader dynamicLoader;
+#endif
     vk::Instance instance;
+    uint32_t instanceApiVersion = VK_API_VERSION_1_0;
     vk::DebugUtilsMessengerEXT debugMessenger;
     vk::SurfaceKHR surface;
 
     vk::PhysicalDevice physicalDevice;
     vk::Device device;
+    vk::PhysicalDeviceFeatures enabledFeatures;
+    vk::PhysicalDeviceVulkan12Features enabledFeatures12;
+    bool timelineSemaphoreEnabled = false; // core 1.2 or VK_KHR_timeline_semaphore
+    bool bindlessSupported = false;
+    BindlessTable bindless;
+    UniformRing uniformRing;
 
     vk::Queue graphicsQueue;
     vk::Queue presentQueue;
+    vk::Queue transferQueue;
+    vk::Queue computeQueue;
+    // Taken around every graphics and present queue submission. Async compute and the upload manager take it as well
+    // when their queue is shared with another submitter.
+    std::mutex graphicsQueueMutex;
 
     vk::SwapchainKHR swapchain;
     std::vector<vk::Image> swapChainImages;
     vk::Format swapChainImageFormat;
     vk::Extent2D swapChainExtent;
     std::vector<vk::ImageView> swapChainImageViews;
-    std::vector<vk::Framebuffer> swapChainFramebuffers;
+    RenderGraph::Attachments graphAttachments;
+
+    vk::Image offscreenImage;
+    Allocation offscreenAllocation;
 
+    DeviceAllocator allocator;
+    PipelineCache pipelineCache;
+    // Frame structure, renderPass is the main pass the pipelines are built against
+    RenderGraph renderGraph;
+    RenderGraph::PassId mainPass = 0;
+    vk::SampleCountFlagBits mainPassSamples = vk::SampleCountFlagBits::e1;
     vk::RenderPass renderPass;
+    uint64_t renderPassKey = 0;
     vk::PipelineLayout pipelineLayout;
     vk::Pipeline graphicsPipeline;
 
     vk::CommandPool commandPool;
-    std::vector<vk::CommandBuffer> commandBuffers;
+
+    std::unique_ptr<ThreadPool> workers;
+    std::vector<FrameCommands> frameCommands;
 
     std::vector<vk::Semaphore> imageAvailableSemaphores;
     std::vector<vk::Semaphore> renderFinishedSemaphores;
-    std::vector<vk::Fence> inFlightFences;
-    std::vector<vk::Fence> imagesInFlight;
+    // Last frame that rendered to each swapchain image
+    std::vector<uint64_t> imageFrames;
+    FramePacer framePacer;
+    UploadManager uploads;
+
+    struct SimulationConstants {
+        float time;
+        uint32_t drawCount;
+    };
+    // MeshConstants in mesh.vert and mesh.frag, std140 so every vec3 takes a vec4
+    static constexpr uint32_t k_meshLights = 3;
+    static inline const vk::ShaderStageFlags k_meshConstantStages = vk::ShaderStageFlagBits::eVertex | vk::ShaderStageFlagBits::eFragment;
+    struct MeshConstants {
+        float viewProjection[16];
+        float eye[4];
+        float lights[k_meshLights][4];
+        float ambient[4];
+    };
+    static_assert(!UniformRing::usesPushConstants(sizeof(MeshConstants)), "the mesh shaders declare MeshConstants as a uniform buffer");
+    AsyncCompute asyncCompute;
+    ComputePipeline simulationPipeline;
+    vk::DescriptorSetLayout simulationSetLayout;
+    vk::DescriptorPool simulationDescriptorPool;
+    std::vector<vk::DescriptorSet> simulationSets;
+    std::vector<BindlessTable::Handle> simulationHandles; // per frame slot, when the bindless table is used
+    std::vector<vk::Buffer> simulationBuffers;
+    std::vector<Allocation> simulationAllocations;
+
+    InstancedScene scene;
+    vk::PipelineLayout scenePipelineLayout;
+    vk::Pipeline scenePipeline;
+
+    AssetStore assets;
+
+    // Graphics pipelines compile in the background, see updatePipelines()
+    PipelineBuilder pipelineBuilder;
+    PipelineRegistry pipelineRegistry;
+    std::chrono::steady_clock::time_point pipelineBatchStart;
+    bool pipelinesReported = false;
+    FileWatcher shaderWatcher;
+    std::deque<std::pair<uint64_t, vk::Pipeline>> retiredPipelines; // old pipeline, last frame using it
+#ifdef __ANDROID__
+    jobject assetManagerRef = nullptr;
+#endif
+    MeshFile meshFile;
+    GpuMesh gpuMesh;
+    std::thread meshLoader;
+    std::atomic<bool> cancelMeshLoad{false};
+    // Set by the loader thread once everything is submitted, 0 until then
+    std::atomic<UploadTicket> meshTicket{0};
+    bool meshReady = false;
+    MeshConstants meshConstants{};
+    vk::PipelineLayout meshPipelineLayout;
+    vk::Pipeline meshPipeline;
+    Profiler profiler;
     
-    size_t currentFrame = 0;
+    struct RetiredSwapchain {
+        vk::SwapchainKHR swapchain;
+        std::vector<vk::ImageView> imageViews;
+        RenderGraph::Attachments attachments;
+        uint64_t releaseFrame; // can be destroyed once this frame has completed
+    };
+    std::deque<RetiredSwapchain> retiredSwapchains;
+    uint32_t swapchainRecreations = 0;
+    double swapchainRecreateSeconds = 0.0;
+
     bool framebufferResized = false;
+    double submitSeconds = 0.0;
+
+    StartupProfiler startup;
+    std::string pipelineCacheDirectory; // SDL's per-user directory, empty (working directory) without one
+#ifndef NARU_EMBED_SHADERS
+    std::mutex preloadedShadersMutex;
+    std::map<std::string, Asset> preloadedShaders;
+#endif
+
+    FrameLimiter frameLimiter;
+    // Set by events that change what is on screen, cleared once a frame has been drawn
+    bool redrawRequested = true;
+    double idleSeconds = 0.0;
+    uint64_t idleWaits = 0;
+
+    // Window events and input travel from the event thread to the render thread
+    SpscQueue<RenderMessage, 256> renderMessages;
+    // Only used to put an idle render thread to sleep, the queue itself never locks
+    std::mutex renderWakeMutex;
+    std::condition_variable renderWake;
+    std::atomic<bool> renderThreadRunning{false};
+    // Owned by the render thread once it runs
+    vk::Extent2D windowExtent{k_width, k_height};
+    bool windowMinimized = false;
+    uint64_t presentedFrames = 0;
+    double presentLatencySeconds = 0.0;
+    double presentLatencyMaxSeconds = 0.0;
 };
 
-int SDL_main(int, char* []) {
+static AppOptions parseOptions(int argc, char* argv[]) {
+    AppOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--headless" && hasValue) {
+            unsigned width = 0, height = 0;
+            if (sscanf(argv[++i], "%ux%u", &width, &height) != 2 || width == 0 || height == 0) {
+                throw std::runtime_error("--headless expects a WIDTHxHEIGHT extent, e.g. --headless 1920x1080");
+            }
+            options.headless = true;
+            options.headlessExtent = vk::Extent2D{width, height};
+        } else if (arg == "--frames" && hasValue) {
+            options.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--dump" && hasValue) {
+            options.dumpPath = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            options.tracePath = argv[++i];
+        } else if (arg == "--profile-csv" && hasValue) {
+            options.profileCsvPath = argv[++i];
+        } else if (arg == "--draws" && hasValue) {
+            options.drawCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--instances" && hasValue) {
+            options.instanceCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+        } else if (arg == "--mesh" && hasValue) {
+            options.meshPath = argv[++i];
+        } else if (arg == "--hot-reload") {
+            options.hotReload = true;
+        } else if (arg == "--frames-in-flight" && hasValue) {
+            options.framesInFlight = std::clamp(static_cast<uint32_t>(std::stoul(argv[++i])),
+                                                FramePacer::k_minFramesInFlight, FramePacer::k_maxFramesInFlight);
+        } else if (arg == "--present" && hasValue) {
+            options.presentPolicy = parsePresentPolicy(argv[++i]);
+        } else if (arg == "--target-fps" && hasValue) {
+            options.targetFps = std::max(std::stod(argv[++i]), 0.0);
+        } else if (arg == "--startup-report" && hasValue) {
+            options.startupReportPath = argv[++i];
+        } else if (arg == "--on-demand") {
+            options.onDemand = true;
+        } else if (arg == "--msaa" && hasValue) {
+            options.msaaSamples = static_cast<uint32_t>(std::stoul(argv[++i]));
+            if (options.msaaSamples != 1 && options.msaaSamples != 2 && options.msaaSamples != 4 && options.msaaSamples != 8) {
+                throw std::runtime_error("--msaa expects a sample count of 1, 2, 4 or 8");
+            }
+        } else if (arg == "--threads" && hasValue) {
+            options.recordingThreads = std::max(static_cast<uint32_t>(std::stoul(argv[++i])), 1u);
+        } else {
+            throw std::runtime_error("unknown or incomplete argument: " + arg);
+        }
+    }
+    if (options.framesInFlight == 0) {
+        options.framesInFlight = defaultFramesInFlight(options.presentPolicy);
+    }
+    if (options.presentPolicy == PresentPolicy::PowerSave && options.targetFps == 0.0) {
+        options.targetFps = FrameLimiter::k_powerSaveFps;
+    }
+    return options;
+}
+
+int SDL_main(int argc, char* argv[]) {
     try {
-        HelloTriangleApplication app {};
+        HelloTriangleApplication app(parseOptions(argc, argv));
         app.run();
     } catch (const std::exception& e) {
         std::cerr << "Error:" << e.what() << std::endl;
         return EXIT_FAILURE;
     }
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
+
+#if defined(__linux__) && !defined(__ANDROID__)
+// SDL2main only provides an entry point on platforms that need one
+int main(int argc, char* argv[]) {
+    return SDL_main(argc, argv);
+}
+#endif
@@ -0,0 +1,398 @@
+#include "memory_allocator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+vk::DeviceSize floorPowerOfTwo(vk::DeviceSize value) {
+    vk::DeviceSize result = 1;
+    while (result * 2 <= value) {
+        result *= 2;
+    }
+    return result;
+}
+}
+
+void DeviceAllocator::init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize blockSize) {
+    this->device = device;
+    this->blockSize = floorPowerOfTwo(std::max(blockSize, k_minAllocationSize));
+    memoryProperties = physicalDevice.getMemoryProperties();
+    auto limits = physicalDevice.getProperties().limits;
+    bufferImageGranularity = limits.bufferImageGranularity;
+    nonCoherentAtomSize = limits.nonCoherentAtomSize;
+}
+
+void DeviceAllocator::destroy() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& pool : pools) {
+        for (auto& block : pool->blocks) {
+            freeDeviceMemory(block->memory, block->mapped != nullptr);
+        }
+    }
+    pools.clear();
+    for (auto& [memory, info] : dedicated) {
+        freeDeviceMemory(vk::DeviceMemory(memory), info.mapped);
+    }
+    dedicated.clear();
+    for (auto& arena : arenas) {
+        freeDeviceMemory(arena.memory, arena.mapped != nullptr);
+    }
+    arenas.clear();
+}
+
+uint32_t DeviceAllocator::findMemoryType(uint32_t typeBits, MemoryUsage usage) const {
+    using Flags = vk::MemoryPropertyFlagBits;
+    switch (usage) {
+    case MemoryUsage::GpuOnly:
+        return findMemoryType(typeBits, {}, Flags::eDeviceLocal);
+    case MemoryUsage::CpuToGpu:
+        return findMemoryType(typeBits, Flags::eHostVisible, Flags::eHostCoherent | Flags::eDeviceLocal);
+    case MemoryUsage::GpuToCpu:
+        return findMemoryType(typeBits, Flags::eHostVisible, Flags::eHostCached | Flags::eHostCoherent);
+    case MemoryUsage::Transient:
+        return findMemoryType(typeBits, {}, Flags::eDeviceLocal | Flags::eLazilyAllocated);
+    }
+    throw std::runtime_error("unknown memory usage!");
+}
+
+// Picks the type with all the required and most of the preferred properties
+uint32_t DeviceAllocator::findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) const {
+    uint32_t bestType = UINT32_MAX;
+    int bestScore = -1;
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        auto flags = memoryProperties.memoryTypes[i].propertyFlags;
+        if (!(typeBits & (1u << i)) || (flags & required) != required) {
+            continue;
+        }
+        // Lazily allocated memory is only useful for transient attachments, never pick it by accident
+        if ((flags & vk::MemoryPropertyFlagBits::eLazilyAllocated) && !(preferred & vk::MemoryPropertyFlagBits::eLazilyAllocated)) {
+            continue;
+        }
+        int score = 0;
+        for (auto bit : {vk::MemoryPropertyFlagBits::eDeviceLocal, vk::MemoryPropertyFlagBits::eHostCoherent,
+                         vk::MemoryPropertyFlagBits::eHostCached, vk::MemoryPropertyFlagBits::eLazilyAllocated}) {
+            if ((preferred & bit) && (flags & bit)) {
+                score += bit == vk::MemoryPropertyFlagBits::eLazilyAllocated ? 4 : 1;
+            }
+        }
+        if (score > bestScore) {
+            bestScore = score;
+            bestType = i;
+        }
+    }
+    if (bestType == UINT32_MAX) {
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+    return bestType;
+}
+
+bool DeviceAllocator::hasLazilyAllocatedMemory() const {
+    for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+        if (memoryProperties.memoryTypes[i].propertyFlags & vk::MemoryPropertyFlagBits::eLazilyAllocated) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DeviceAllocator::isHostVisible(uint32_t memoryType) const {
+    return static_cast<bool>(memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible);
+}
+
+bool DeviceAllocator::isCoherent(uint32_t memoryType) const {
+    return static_cast<bool>(memoryProperties.memoryTypes[memoryType].propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+}
+
+vk::DeviceMemory DeviceAllocator::allocateDeviceMemory(vk::DeviceSize size, uint32_t memoryType, void** mapped) {
+    vk::MemoryAllocateInfo allocInfo{};
+    allocInfo.setAllocationSize(size)
+        .setMemoryTypeIndex(memoryType);
+    vk::DeviceMemory memory = device.allocateMemory(allocInfo);
+    *mapped = isHostVisible(memoryType) ? device.mapMemory(memory, 0, VK_WHOLE_SIZE) : nullptr;
+    return memory;
+}
+
+void DeviceAllocator::freeDeviceMemory(vk::DeviceMemory memory, bool isMapped) {
+    if (isMapped) {
+        device.unmapMemory(memory);
+    }
+    device.freeMemory(memory);
+}
+
+DeviceAllocator::Pool& DeviceAllocator::getPool(uint32_t memoryType, ResourceKind kind) {
+    // With a granularity of 1 linear and optimal resources can safely share pages
+    if (bufferImageGranularity <= 1) {
+        kind = ResourceKind::Linear;
+    }
+    for (auto& pool : pools) {
+        if (pool->memoryType == memoryType && pool->kind == kind) {
+            return *pool;
+        }
+    }
+    auto pool = std::make_unique<Pool>();
+    pool->memoryType = memoryType;
+    pool->kind = kind;
+    // Small heaps (e.g. 256MB device-local host-visible windows) get proportionally smaller blocks
+    vk::DeviceSize heapSize = memoryProperties.memoryHeaps[memoryProperties.memoryTypes[memoryType].heapIndex].size;
+    pool->blockSize = std::max(floorPowerOfTwo(std::min(blockSize, heapSize / 8)), k_minAllocationSize);
+    pool->maxOrder = orderFor(pool->blockSize);
+    pools.push_back(std::move(pool));
+    return *pools.back();
+}
+
+DeviceAllocator::Block* DeviceAllocator::createBlock(Pool& pool) {
+    auto block = std::make_unique<Block>();
+    block->memory = allocateDeviceMemory(pool.blockSize, pool.memoryType, &block->mapped);
+    block->freeLists.resize(pool.maxOrder + 1);
+    block->freeLists[pool.maxOrder].insert(0);
+    pool.blocks.push_back(std::move(block));
+    return pool.blocks.back().get();
+}
+
+uint32_t DeviceAllocator::orderFor(vk::DeviceSize size) {
+    uint32_t order = 0;
+    while (orderSize(order) < size) {
+        order++;
+    }
+    return order;
+}
+
+// Buddy allocation: take the smallest free range that fits and split it in halves down to the requested order.
+// Ranges are aligned to their own size, so any alignment up to the allocation size comes for free.
+bool DeviceAllocator::allocateFromBlock(const Pool& pool, Block& block, uint32_t order, vk::DeviceSize& offset) {
+    uint32_t available = order;
+    while (available <= pool.maxOrder && block.freeLists[available].empty()) {
+        available++;
+    }
+    if (available > pool.maxOrder) {
+        return false;
+    }
+    offset = *block.freeLists[available].begin();
+    block.freeLists[available].erase(block.freeLists[available].begin());
+    while (available > order) {
+        available--;
+        block.freeLists[available].insert(offset + orderSize(available)); // upper half becomes free
+    }
+    block.usedBytes += orderSize(order);
+    block.allocations++;
+    return true;
+}
+
+void DeviceAllocator::freeToBlock(const Pool& pool, Block& block, vk::DeviceSize offset, uint32_t order) {
+    block.usedBytes -= orderSize(order);
+    block.allocations--;
+    // Merge with the buddy for as long as it is free as well
+    while (order < pool.maxOrder) {
+        vk::DeviceSize buddy = offset ^ orderSize(order);
+        auto it = block.freeLists[order].find(buddy);
+        if (it == block.freeLists[order].end()) {
+            break;
+        }
+        block.freeLists[order].erase(it);
+        offset = std::min(offset, buddy);
+        order++;
+    }
+    block.freeLists[order].insert(offset);
+}
+
+Allocation DeviceAllocator::allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Allocation allocation{};
+    allocation.memoryType = findMemoryType(requirements.memoryTypeBits, usage);
+    allocation.coherent = isCoherent(allocation.memoryType);
+    allocation.size = requirements.size;
+
+    Pool& pool = getPool(allocation.memoryType, kind);
+    vk::DeviceSize needed = std::max({requirements.size, requirements.alignment, k_minAllocationSize});
+    // Lazily allocated memory is committed per allocation anyway, and large resources would waste most of a block
+    if (usage == MemoryUsage::Transient || needed > pool.blockSize / 2) {
+        allocation.source = Allocation::Source::Dedicated;
+        allocation.memory = allocateDeviceMemory(requirements.size, allocation.memoryType, &allocation.mapped);
+        dedicated[static_cast<VkDeviceMemory>(allocation.memory)] = {requirements.size, allocation.mapped != nullptr};
+        return allocation;
+    }
+
+    uint32_t order = orderFor(needed);
+    vk::DeviceSize offset = 0;
+    uint32_t blockIndex = 0;
+    for (; blockIndex < pool.blocks.size(); blockIndex++) {
+        if (allocateFromBlock(pool, *pool.blocks[blockIndex], order, offset)) {
+            break;
+        }
+    }
+    if (blockIndex == pool.blocks.size()) {
+        allocateFromBlock(pool, *createBlock(pool), order, offset);
+    }
+    Block& block = *pool.blocks[blockIndex];
+    allocation.source = Allocation::Source::Buddy;
+    allocation.memory = block.memory;
+    allocation.offset = offset;
+    allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + offset : nullptr;
+    allocation.pool = static_cast<uint32_t>(std::find_if(pools.begin(), pools.end(),
+        [&](const std::unique_ptr<Pool>& candidate) { return candidate.get() == &pool; }) - pools.begin());
+    allocation.block = blockIndex;
+    allocation.order = order;
+    return allocation;
+}
+
+void DeviceAllocator::free(Allocation& allocation) {
+    if (!allocation) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    switch (allocation.source) {
+    case Allocation::Source::Dedicated: {
+        auto it = dedicated.find(static_cast<VkDeviceMemory>(allocation.memory));
+        freeDeviceMemory(allocation.memory, it->second.mapped);
+        dedicated.erase(it);
+        break;
+    }
+    case Allocation::Source::Buddy: {
+        Pool& pool = *pools[allocation.pool];
+        freeToBlock(pool, *pool.blocks[allocation.block], allocation.offset, allocation.order);
+        break;
+    }
+    case Allocation::Source::Arena:
+        break; // released all at once by resetFrame
+    }
+    allocation = Allocation{};
+}
+
+vk::Buffer DeviceAllocator::createBuffer(const vk::BufferCreateInfo& createInfo, MemoryUsage usage, Allocation& allocation) {
+    vk::Buffer buffer = device.createBuffer(createInfo);
+    allocation = allocate(device.getBufferMemoryRequirements(buffer), usage, ResourceKind::Linear);
+    device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+    return buffer;
+}
+
+vk::Image DeviceAllocator::createImage(const vk::ImageCreateInfo& createInfo, MemoryUsage usage, Allocation& allocation) {
+    vk::Image image = device.createImage(createInfo);
+    auto kind = createInfo.tiling == vk::ImageTiling::eLinear ? ResourceKind::Linear : ResourceKind::Optimal;
+    allocation = allocate(device.getImageMemoryRequirements(image), usage, kind);
+    device.bindImageMemory(image, allocation.memory, allocation.offset);
+    return image;
+}
+
+void DeviceAllocator::destroyBuffer(vk::Buffer buffer, Allocation& allocation) {
+    device.destroyBuffer(buffer);
+    free(allocation);
+}
+
+void DeviceAllocator::destroyImage(vk::Image image, Allocation& allocation) {
+    device.destroyImage(image);
+    free(allocation);
+}
+
+void DeviceAllocator::flush(const Allocation& allocation, vk::DeviceSize offset, vk::DeviceSize size) {
+    if (allocation.coherent || !allocation.mapped) {
+        return;
+    }
+    // Flushed ranges must be multiples of nonCoherentAtomSize (or reach the end of the memory object)
+    vk::DeviceSize begin = allocation.offset + offset;
+    vk::DeviceSize end = size == VK_WHOLE_SIZE ? allocation.offset + allocation.size : begin + size;
+    vk::MappedMemoryRange range{};
+    range.setMemory(allocation.memory)
+        .setOffset(begin / nonCoherentAtomSize * nonCoherentAtomSize)
+        .setSize(VK_WHOLE_SIZE);
+    vk::DeviceSize alignedEnd = alignUp(end, nonCoherentAtomSize);
+    if (allocation.source != Allocation::Source::Dedicated) {
+        range.setSize(alignedEnd - range.offset);
+    }
+    (void)device.flushMappedMemoryRanges(1, &range);
+}
+
+void DeviceAllocator::createFrameArenas(uint32_t frameSlots, vk::DeviceSize sizePerFrame, MemoryUsage usage) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // Any buffer usage is fine for the memory type query, all buffer memory types are compatible with uniform/storage data
+    uint32_t memoryType = findMemoryType(~0u, usage);
+    arenas.resize(frameSlots);
+    for (auto& arena : arenas) {
+        arena.memoryType = memoryType;
+        arena.size = sizePerFrame;
+        arena.memory = allocateDeviceMemory(sizePerFrame, memoryType, &arena.mapped);
+    }
+}
+
+Allocation DeviceAllocator::allocateFrame(uint32_t slot, const vk::MemoryRequirements& requirements, ResourceKind kind) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Arena& arena = arenas.at(slot);
+    if (!(requirements.memoryTypeBits & (1u << arena.memoryType))) {
+        throw std::runtime_error("resource is not compatible with the frame arena memory type!");
+    }
+    vk::DeviceSize alignment = std::max<vk::DeviceSize>(requirements.alignment, 1);
+    // Switching between linear and optimal resources inside a block needs bufferImageGranularity spacing
+    if (arena.allocations > 0 && kind != arena.lastKind) {
+        alignment = std::max(alignment, bufferImageGranularity);
+    }
+    vk::DeviceSize offset = alignUp(arena.head, alignment);
+    if (offset + requirements.size > arena.size) {
+        throw std::runtime_error("frame arena exhausted (" + std::to_string(arena.size) + " bytes per frame)");
+    }
+    arena.head = offset + requirements.size;
+    arena.lastKind = kind;
+    arena.allocations++;
+
+    Allocation allocation{};
+    allocation.source = Allocation::Source::Arena;
+    allocation.memory = arena.memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.memoryType = arena.memoryType;
+    allocation.coherent = isCoherent(arena.memoryType);
+    allocation.mapped = arena.mapped ? static_cast<char*>(arena.mapped) + offset : nullptr;
+    return allocation;
+}
+
+void DeviceAllocator::resetFrame(uint32_t slot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Arena& arena = arenas.at(slot);
+    arena.head = 0;
+    arena.allocations = 0;
+}
+
+MemoryStats DeviceAllocator::stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    MemoryStats stats{};
+    vk::DeviceSize freeBytes = 0;
+    for (const auto& pool : pools) {
+        for (const auto& block : pool->blocks) {
+            stats.deviceMemoryObjects++;
+            stats.allocations += block->allocations;
+            stats.reservedBytes += pool->blockSize;
+            stats.usedBytes += block->usedBytes;
+            freeBytes += pool->blockSize - block->usedBytes;
+            for (uint32_t order = pool->maxOrder + 1; order-- > 0;) {
+                if (!block->freeLists[order].empty()) {
+                    stats.largestFreeRange = std::max(stats.largestFreeRange, orderSize(order));
+                    break;
+                }
+            }
+        }
+    }
+    for (const auto& [memory, info] : dedicated) {
+        stats.deviceMemoryObjects++;
+        stats.allocations++;
+        stats.reservedBytes += info.size;
+        stats.usedBytes += info.size;
+    }
+    for (const auto& arena : arenas) {
+        stats.deviceMemoryObjects++;
+        stats.allocations += arena.allocations;
+        stats.reservedBytes += arena.size;
+        stats.usedBytes += arena.head;
+    }
+    stats.fragmentation = freeBytes > 0 ? 1.0 - double(stats.largestFreeRange) / double(freeBytes) : 0.0;
+    return stats;
+}
+
+void DeviceAllocator::printStats(std::ostream& out) const {
+    auto current = stats();
+    out << "Device memory: " << current.allocations << " allocations in " << current.deviceMemoryObjects
+        << " memory objects, " << (current.usedBytes >> 10) << " KiB used of " << (current.reservedBytes >> 10)
+        << " KiB reserved, fragmentation " << current.fragmentation << std::endl;
+}
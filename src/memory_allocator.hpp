@@ -0,0 +1,141 @@
+#pragma once
+#include "vulkan_common.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <vector>
+
+enum class MemoryUsage {
+    GpuOnly,   // device-local, never touched by the CPU
+    CpuToGpu,  // host-visible and persistently mapped, for uploads and per-frame data
+    GpuToCpu,  // host-visible and preferably cached, for readbacks
+    Transient, // lazily allocated when available, for attachments that never leave tile memory
+};
+
+// Linear resources (buffers, linear images) and optimal-tiling images must respect bufferImageGranularity
+// when they share a memory block, so they are kept apart.
+enum class ResourceKind {
+    Linear,
+    Optimal,
+};
+
+struct Allocation {
+    vk::DeviceMemory memory;
+    vk::DeviceSize offset = 0;
+    vk::DeviceSize size = 0;
+    void* mapped = nullptr; // persistently mapped pointer for host-visible memory
+    uint32_t memoryType = 0;
+    bool coherent = true;
+
+    explicit operator bool() const { return static_cast<bool>(memory); }
+
+private:
+    friend class DeviceAllocator;
+    enum class Source : uint8_t { Buddy, Dedicated, Arena } source = Source::Buddy;
+    uint32_t pool = 0;
+    uint32_t block = 0;
+    uint32_t order = 0;
+};
+
+struct MemoryStats {
+    uint32_t deviceMemoryObjects = 0; // vkAllocateMemory calls currently alive
+    uint32_t allocations = 0;
+    vk::DeviceSize reservedBytes = 0;
+    vk::DeviceSize usedBytes = 0;
+    vk::DeviceSize largestFreeRange = 0;
+    // 0 when all free space is one contiguous range, approaching 1 when it is scattered in small pieces
+    double fragmentation = 0.0;
+};
+
+// Reserves large device memory blocks per memory type and sub-allocates resources from them.
+// Long-lived resources use a buddy allocator per block, per-frame data uses linear arenas that are reset
+// once their frame slot comes around again. Requests bigger than half a block get a dedicated allocation.
+class DeviceAllocator {
+public:
+    static constexpr vk::DeviceSize k_defaultBlockSize = 64ull << 20;
+    static constexpr vk::DeviceSize k_minAllocationSize = 256;
+
+    void init(vk::PhysicalDevice physicalDevice, vk::Device device, vk::DeviceSize blockSize = k_defaultBlockSize);
+    void destroy();
+
+    Allocation allocate(const vk::MemoryRequirements& requirements, MemoryUsage usage, ResourceKind kind);
+    void free(Allocation& allocation);
+
+    // Create the resource, allocate and bind its memory in one go
+    vk::Buffer createBuffer(const vk::BufferCreateInfo& createInfo, MemoryUsage usage, Allocation& allocation);
+    vk::Image createImage(const vk::ImageCreateInfo& createInfo, MemoryUsage usage, Allocation& allocation);
+    void destroyBuffer(vk::Buffer buffer, Allocation& allocation);
+    void destroyImage(vk::Image image, Allocation& allocation);
+
+    // Makes CPU writes visible on non-coherent memory, a no-op on coherent memory
+    void flush(const Allocation& allocation, vk::DeviceSize offset = 0, vk::DeviceSize size = VK_WHOLE_SIZE);
+
+    // Per-frame linear arenas: one block per frame slot, bump-allocated and reset all at once.
+    void createFrameArenas(uint32_t frameSlots, vk::DeviceSize sizePerFrame, MemoryUsage usage);
+    Allocation allocateFrame(uint32_t slot, const vk::MemoryRequirements& requirements, ResourceKind kind);
+    // Only call once the GPU has finished the frame that last used the slot
+    void resetFrame(uint32_t slot);
+
+    uint32_t findMemoryType(uint32_t typeBits, MemoryUsage usage) const;
+    bool hasLazilyAllocatedMemory() const;
+
+    MemoryStats stats() const;
+    void printStats(std::ostream& out) const;
+
+private:
+    struct Block {
+        vk::DeviceMemory memory;
+        void* mapped = nullptr;
+        // Free ranges per buddy order, order 0 being k_minAllocationSize
+        std::vector<std::set<vk::DeviceSize>> freeLists;
+        vk::DeviceSize usedBytes = 0;
+        uint32_t allocations = 0;
+    };
+    struct Pool {
+        uint32_t memoryType;
+        ResourceKind kind;
+        vk::DeviceSize blockSize;
+        uint32_t maxOrder;
+        std::vector<std::unique_ptr<Block>> blocks;
+    };
+    struct Dedicated {
+        vk::DeviceSize size;
+        bool mapped;
+    };
+    struct Arena {
+        vk::DeviceMemory memory;
+        void* mapped = nullptr;
+        uint32_t memoryType = 0;
+        vk::DeviceSize size = 0;
+        vk::DeviceSize head = 0;
+        ResourceKind lastKind = ResourceKind::Linear;
+        uint32_t allocations = 0;
+    };
+
+    uint32_t findMemoryType(uint32_t typeBits, vk::MemoryPropertyFlags required, vk::MemoryPropertyFlags preferred) const;
+    vk::DeviceMemory allocateDeviceMemory(vk::DeviceSize size, uint32_t memoryType, void** mapped);
+    void freeDeviceMemory(vk::DeviceMemory memory, bool isMapped);
+    Pool& getPool(uint32_t memoryType, ResourceKind kind);
+    Block* createBlock(Pool& pool);
+    bool allocateFromBlock(const Pool& pool, Block& block, uint32_t order, vk::DeviceSize& offset);
+    void freeToBlock(const Pool& pool, Block& block, vk::DeviceSize offset, uint32_t order);
+    static uint32_t orderFor(vk::DeviceSize size);
+    static vk::DeviceSize orderSize(uint32_t order) { return k_minAllocationSize << order; }
+    bool isHostVisible(uint32_t memoryType) const;
+    bool isCoherent(uint32_t memoryType) const;
+
+    vk::Device device;
+    vk::PhysicalDeviceMemoryProperties memoryProperties;
+    vk::DeviceSize bufferImageGranularity = 1;
+    vk::DeviceSize nonCoherentAtomSize = 1;
+    vk::DeviceSize blockSize = k_defaultBlockSize;
+
+    mutable std::mutex mutex;
+    std::vector<std::unique_ptr<Pool>> pools;
+    std::map<VkDeviceMemory, Dedicated> dedicated;
+    std::vector<Arena> arenas;
+};
@@ -0,0 +1,190 @@
+#include "mesh_file.hpp"
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+
+namespace {
+// Uploads go out in pieces so a cancelled load stops within one piece, and the staging ring keeps
+// recycling while the kernel reads ahead
+constexpr vk::DeviceSize k_uploadPiece = 8ull << 20;
+
+// Size of one vertex attribute, 0 for formats the loader does not accept
+uint32_t formatSize(vk::Format format) {
+    switch (format) {
+    case vk::Format::eR32Sfloat:
+    case vk::Format::eR32Uint:
+    case vk::Format::eR16G16Sfloat:
+    case vk::Format::eR16G16Unorm:
+    case vk::Format::eR8G8B8A8Unorm:
+    case vk::Format::eR8G8B8A8Snorm:
+    case vk::Format::eA2B10G10R10SnormPack32:
+        return 4;
+    case vk::Format::eR32G32Sfloat:
+    case vk::Format::eR16G16B16A16Sfloat:
+    case vk::Format::eR16G16B16A16Snorm:
+        return 8;
+    case vk::Format::eR32G32B32Sfloat:
+        return 12;
+    case vk::Format::eR32G32B32A32Sfloat:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+// Section [offset, offset + size) lies within the file, without overflowing
+bool fits(uint64_t offset, uint64_t size, uint64_t fileSize) {
+    return offset <= fileSize && size <= fileSize - offset;
+}
+}
+
+MeshFile MeshFile::open(const AssetStore& assets, const std::string& path) {
+    MeshFile mesh;
+    mesh.file = assets.open(path);
+    uint64_t fileSize = mesh.file.bytes().size();
+    auto invalid = [&](const std::string& reason) {
+        return std::runtime_error("invalid mesh file " + path + ": " + reason + "!");
+    };
+
+    if (fileSize < sizeof(MeshFileHeader)) {
+        throw invalid("too small");
+    }
+    const MeshFileHeader& header = mesh.header();
+    if (header.magic != k_meshFileMagic) {
+        throw invalid("bad magic");
+    }
+    if (header.version != k_meshFileVersion) {
+        throw invalid("unsupported version " + std::to_string(header.version));
+    }
+    if (header.indexType != VK_INDEX_TYPE_UINT16 && header.indexType != VK_INDEX_TYPE_UINT32) {
+        throw invalid("unsupported index type");
+    }
+    uint64_t tableSize = (uint64_t(header.streamCount) + header.attributeCount + header.submeshCount) * 16;
+    if (header.streamCount == 0 || header.submeshCount == 0 || !fits(sizeof(MeshFileHeader), tableSize, fileSize)) {
+        throw invalid("truncated tables");
+    }
+
+    for (uint32_t i = 0; i < header.streamCount; i++) {
+        const MeshFileStream& stream = mesh.streams()[i];
+        if (stream.stride == 0 || stream.offset % k_meshFileAlignment != 0 ||
+            header.vertexCount > fileSize / stream.stride || !fits(stream.offset, header.vertexCount * stream.stride, fileSize)) {
+            throw invalid("vertex stream " + std::to_string(i) + " out of bounds");
+        }
+    }
+    std::set<uint32_t> locations;
+    bool hasPosition = false;
+    for (uint32_t i = 0; i < header.attributeCount; i++) {
+        const MeshFileAttribute& attribute = mesh.attributes()[i];
+        uint32_t size = formatSize(vk::Format(attribute.format));
+        if (size == 0) {
+            throw invalid("attribute " + std::to_string(i) + " has an unsupported format");
+        }
+        if (attribute.stream >= header.streamCount || uint64_t(attribute.offset) + size > mesh.streams()[attribute.stream].stride) {
+            throw invalid("attribute " + std::to_string(i) + " lies outside its stream");
+        }
+        if (!locations.insert(attribute.location).second) {
+            throw invalid("location " + std::to_string(attribute.location) + " declared twice");
+        }
+        hasPosition |= attribute.location == 0 && vk::Format(attribute.format) == vk::Format::eR32G32B32Sfloat;
+    }
+    if (!hasPosition) {
+        throw invalid("no R32G32B32 position at location 0");
+    }
+
+    if (header.indexOffset % k_meshFileAlignment != 0 || header.indexCount > fileSize / mesh.indexStride() ||
+        !fits(header.indexOffset, mesh.indexSize(), fileSize)) {
+        throw invalid("index buffer out of bounds");
+    }
+    for (uint32_t i = 0; i < header.submeshCount; i++) {
+        const MeshFileSubmesh& submesh = mesh.submeshes()[i];
+        if (!fits(submesh.firstIndex, submesh.indexCount, header.indexCount) ||
+            submesh.vertexOffset < 0 || uint64_t(submesh.vertexOffset) >= header.vertexCount) {
+            throw invalid("submesh " + std::to_string(i) + " out of bounds");
+        }
+    }
+    return mesh;
+}
+
+std::vector<vk::VertexInputBindingDescription> MeshFile::vertexBindings() const {
+    std::vector<vk::VertexInputBindingDescription> bindings;
+    for (uint32_t i = 0; i < header().streamCount; i++) {
+        bindings.emplace_back(i, streams()[i].stride, vk::VertexInputRate::eVertex);
+    }
+    return bindings;
+}
+
+std::vector<vk::VertexInputAttributeDescription> MeshFile::vertexAttributes() const {
+    std::vector<vk::VertexInputAttributeDescription> descriptions;
+    for (uint32_t i = 0; i < header().attributeCount; i++) {
+        const MeshFileAttribute& attribute = attributes()[i];
+        descriptions.emplace_back(attribute.location, attribute.stream, vk::Format(attribute.format), attribute.offset);
+    }
+    return descriptions;
+}
+
+void GpuMesh::create(DeviceAllocator& allocator, const MeshFile& mesh) {
+    this->mesh = &mesh;
+    this->allocator = &allocator;
+    auto createBuffer = [&](vk::DeviceSize size, vk::BufferUsageFlags usage, Allocation& allocation) {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.setSize(std::max<vk::DeviceSize>(size, 4))
+            .setUsage(usage | vk::BufferUsageFlagBits::eTransferDst)
+            .setSharingMode(vk::SharingMode::eExclusive);
+        return allocator.createBuffer(bufferInfo, MemoryUsage::GpuOnly, allocation);
+    };
+    uint32_t streamCount = mesh.header().streamCount;
+    vertexBuffers.resize(streamCount);
+    vertexAllocations.resize(streamCount);
+    vertexOffsets.assign(streamCount, 0); // every stream starts at the beginning of its own buffer
+    for (uint32_t i = 0; i < streamCount; i++) {
+        vertexBuffers[i] = createBuffer(mesh.streamSize(i), vk::BufferUsageFlagBits::eVertexBuffer, vertexAllocations[i]);
+    }
+    indexBuffer = createBuffer(mesh.indexSize(), vk::BufferUsageFlagBits::eIndexBuffer, indexAllocation);
+}
+
+UploadTicket GpuMesh::upload(UploadManager& uploads, const std::atomic<bool>& cancel) {
+    // Straight from the mapped pages into the staging ring, the file is never copied anywhere else
+    auto stream = [&](vk::Buffer buffer, const std::byte* data, uint64_t size) {
+        mesh->asset().adviseSequential(static_cast<size_t>(data - mesh->asset().bytes().data()), static_cast<size_t>(size));
+        for (uint64_t done = 0; done < size; done += k_uploadPiece) {
+            if (cancel.load(std::memory_order_relaxed)) {
+                return false;
+            }
+            uploads.uploadBuffer(buffer, done, data + done, std::min<uint64_t>(k_uploadPiece, size - done));
+        }
+        return true;
+    };
+    for (uint32_t i = 0; i < vertexBuffers.size(); i++) {
+        if (!stream(vertexBuffers[i], mesh->streamData(i), mesh->streamSize(i))) {
+            return 0;
+        }
+    }
+    if (!stream(indexBuffer, mesh->indexData(), mesh->indexSize())) {
+        return 0;
+    }
+    return uploads.flush();
+}
+
+void GpuMesh::destroy() {
+    if (!allocator) {
+        return;
+    }
+    for (size_t i = 0; i < vertexBuffers.size(); i++) {
+        allocator->destroyBuffer(vertexBuffers[i], vertexAllocations[i]);
+    }
+    vertexBuffers.clear();
+    vertexAllocations.clear();
+    vertexOffsets.clear();
+    allocator->destroyBuffer(indexBuffer, indexAllocation);
+    allocator = nullptr;
+}
+
+void GpuMesh::draw(vk::CommandBuffer commandBuffer) const {
+    commandBuffer.bindVertexBuffers(0, static_cast<uint32_t>(vertexBuffers.size()), vertexBuffers.data(), vertexOffsets.data());
+    commandBuffer.bindIndexBuffer(indexBuffer, 0, vk::IndexType(mesh->header().indexType));
+    for (uint32_t i = 0; i < mesh->header().submeshCount; i++) {
+        const MeshFileSubmesh& submesh = mesh->submeshes()[i];
+        commandBuffer.drawIndexed(submesh.indexCount, 1, submesh.firstIndex, submesh.vertexOffset, 0);
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include "vulkan_common.hpp"
+#include "memory_allocator.hpp"
+#include "upload_manager.hpp"
+#include "asset_store.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Naru binary mesh (.nmesh). Little endian, laid out so a loader never parses per-vertex data:
+//
+//   MeshFileHeader
+//   MeshFileStream[streamCount]        one per vertex buffer binding
+//   MeshFileAttribute[attributeCount]  bound to the pipeline as declared
+//   MeshFileSubmesh[submeshCount]
+//   vertex streams and the index buffer, each at a k_meshFileAlignment aligned offset from the start of the file
+//
+// Attribute locations follow the shader convention 0 position, 1 normal, 2 color, 3 texcoord; only
+// the position (3 floats) is required.
+constexpr uint32_t k_meshFileMagic = 0x48534D4E; // "NMSH"
+constexpr uint32_t k_meshFileVersion = 1;
+constexpr uint64_t k_meshFileAlignment = 16;
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t streamCount;
+    uint32_t attributeCount;
+    uint32_t submeshCount;
+    uint32_t indexType; // VkIndexType, 16 or 32 bit
+    uint64_t vertexCount;
+    uint64_t indexCount;
+    uint64_t indexOffset;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t reserved[2];
+};
+
+struct MeshFileStream {
+    uint64_t offset;
+    uint32_t stride;
+    uint32_t reserved;
+};
+
+struct MeshFileAttribute {
+    uint32_t location;
+    uint32_t stream;
+    uint32_t format; // VkFormat
+    uint32_t offset; // within the stream's vertex
+};
+
+struct MeshFileSubmesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t material;
+};
+
+static_assert(sizeof(MeshFileHeader) == 80 && sizeof(MeshFileStream) == 16 &&
+              sizeof(MeshFileAttribute) == 16 && sizeof(MeshFileSubmesh) == 16,
+              "the mesh file tables are read in place and must not change size");
+
+// A .nmesh asset, mapped in place. open() validates the header and tables against the file size and nothing else,
+// the vertex and index data are only touched by the upload.
+class MeshFile {
+public:
+    static MeshFile open(const AssetStore& assets, const std::string& path);
+
+    const MeshFileHeader& header() const { return *reinterpret_cast<const MeshFileHeader*>(base()); }
+    const MeshFileStream* streams() const { return reinterpret_cast<const MeshFileStream*>(base() + sizeof(MeshFileHeader)); }
+    const MeshFileAttribute* attributes() const { return reinterpret_cast<const MeshFileAttribute*>(streams() + header().streamCount); }
+    const MeshFileSubmesh* submeshes() const { return reinterpret_cast<const MeshFileSubmesh*>(attributes() + header().attributeCount); }
+
+    const std::byte* streamData(uint32_t stream) const { return base() + streams()[stream].offset; }
+    uint64_t streamSize(uint32_t stream) const { return header().vertexCount * streams()[stream].stride; }
+    const std::byte* indexData() const { return base() + header().indexOffset; }
+    uint64_t indexSize() const { return header().indexCount * indexStride(); }
+    uint64_t indexStride() const { return header().indexType == VK_INDEX_TYPE_UINT32 ? 4 : 2; }
+
+    // Vertex input state as declared by the file: binding i is stream i
+    std::vector<vk::VertexInputBindingDescription> vertexBindings() const;
+    std::vector<vk::VertexInputAttributeDescription> vertexAttributes() const;
+
+    const Asset& asset() const { return file; }
+    bool isOpen() const { return file.isOpen(); }
+
+private:
+    const std::byte* base() const { return file.bytes().data(); }
+
+    Asset file;
+};
+
+// Device copy of a MeshFile: one vertex buffer per stream plus the index buffer
+class GpuMesh {
+public:
+    void create(DeviceAllocator& allocator, const MeshFile& mesh);
+    // Streams the mapped file into the buffers through the staging ring. Meant for a loader thread: returns
+    // the ticket to wait for, or 0 if cancel was raised before everything was uploaded.
+    UploadTicket upload(UploadManager& uploads, const std::atomic<bool>& cancel);
+    void destroy();
+
+    // Inside a render pass with a pipeline built from the file's vertex input state
+    void draw(vk::CommandBuffer commandBuffer) const;
+
+private:
+    const MeshFile* mesh = nullptr;
+    DeviceAllocator* allocator = nullptr;
+    std::vector<vk::Buffer> vertexBuffers;
+    std::vector<Allocation> vertexAllocations;
+    std::vector<vk::DeviceSize> vertexOffsets; // bound with the buffers, so draw() does not allocate
+    vk::Buffer indexBuffer;
+    Allocation indexAllocation;
+};
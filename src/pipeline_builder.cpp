@@ -0,0 +1,139 @@
+#include "pipeline_builder.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+void PipelineBuilder::init(vk::Device device, vk::PipelineCache sharedCache, uint32_t threadCount, ShaderLoader loadShader) {
+    this->device = device;
+    this->sharedCache = sharedCache;
+    this->loadShader = std::move(loadShader);
+    stopping = false;
+    cachesDirty = false;
+
+    // Warm start: every worker sees what previous runs already compiled
+    auto initialData = device.getPipelineCacheData(sharedCache);
+    vk::PipelineCacheCreateInfo createInfo{};
+    createInfo.setInitialDataSize(initialData.size())
+        .setPInitialData(initialData.empty() ? nullptr : initialData.data());
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workerCaches.push_back(device.createPipelineCache(createInfo));
+    }
+    for (uint32_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&PipelineBuilder::workerLoop, this, i);
+    }
+}
+
+void PipelineBuilder::destroy() {
+    if (workers.empty()) {
+        return;
+    }
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    mergeCaches();
+    for (auto& result : finished) {
+        device.destroyPipeline(result.pipeline);
+    }
+    finished.clear();
+    for (auto cache : workerCaches) {
+        device.destroyPipelineCache(cache);
+    }
+    workerCaches.clear();
+}
+
+void PipelineBuilder::submit(std::vector<Request> requests) {
+    if (requests.empty()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& request : requests) {
+            queue.push_back(std::move(request));
+        }
+    }
+    wake.notify_all();
+}
+
+std::vector<PipelineBuilder::Result> PipelineBuilder::collect() {
+    std::vector<Result> results;
+    bool merge;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.swap(finished);
+        // Idle workers do not touch their caches, so they can be read while merging
+        merge = cachesDirty && queue.empty() && active == 0;
+        if (merge) {
+            cachesDirty = false;
+        }
+    }
+    if (merge) {
+        mergeCaches();
+    }
+    return results;
+}
+
+void PipelineBuilder::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return queue.empty() && active == 0; });
+}
+
+void PipelineBuilder::workerLoop(uint32_t index) {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return; // stopping, and nothing left to build
+        }
+        Request request = std::move(queue.front());
+        queue.pop_front();
+        active++;
+        lock.unlock();
+
+        Result result = build(request, workerCaches[index]);
+
+        lock.lock();
+        finished.push_back(std::move(result));
+        cachesDirty = true;
+        active--;
+        if (queue.empty() && active == 0) {
+            idle.notify_all();
+        }
+    }
+}
+
+PipelineBuilder::Result PipelineBuilder::build(const Request& request, vk::PipelineCache cache) {
+    auto start = std::chrono::steady_clock::now();
+    Result result{};
+    result.request = request;
+    GraphicsPipelineDesc desc = request.desc;
+    try {
+        desc.vertexShader = loadShader(request.vertexShader);
+        desc.fragmentShader = loadShader(request.fragmentShader);
+        result.pipeline = buildGraphicsPipeline(device, desc, cache);
+    } catch (const std::exception& e) {
+        result.error = e.what();
+    }
+    // The modules are only needed while the pipeline is being created
+    if (desc.vertexShader) {
+        device.destroyShaderModule(desc.vertexShader);
+    }
+    if (desc.fragmentShader) {
+        device.destroyShaderModule(desc.fragmentShader);
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void PipelineBuilder::mergeCaches() {
+    if (!workerCaches.empty()) {
+        device.mergePipelineCaches(sharedCache, workerCaches);
+    }
+}
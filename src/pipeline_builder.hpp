@@ -0,0 +1,68 @@
+#pragma once
+#include "vulkan_common.hpp"
+#include "pipelines.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Builds graphics pipelines on a pool of background threads so startup and shader reloads never block a frame.
+// Every worker compiles into its own VkPipelineCache, seeded from the shared cache, so the driver never
+// serializes the workers on one cache. The worker caches are merged back into the shared cache by collect()
+// once the builder is idle, which keeps every external access to the shared cache on the calling thread.
+class PipelineBuilder {
+public:
+    // Must be safe to call from any worker thread
+    using ShaderLoader = std::function<vk::ShaderModule(const std::string& name)>;
+
+    struct Request {
+        GraphicsPipelineDesc desc; // the shader modules are filled in by the builder
+        std::string vertexShader;
+        std::string fragmentShader;
+        vk::Pipeline* target = nullptr; // tells the caller where the result belongs, never written by the builder
+    };
+    struct Result {
+        Request request;
+        vk::Pipeline pipeline; // null when the build failed
+        std::string error;
+        double milliseconds = 0.0;
+    };
+
+    void init(vk::Device device, vk::PipelineCache sharedCache, uint32_t threadCount, ShaderLoader loadShader);
+    // Waits for the queued builds, merges the caches and destroys results nobody collected
+    void destroy();
+
+    uint32_t threadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+    // Returns immediately, the pipelines show up in collect() as they finish
+    void submit(std::vector<Request> requests);
+    // Pipelines finished since the previous call, in completion order. The caller owns them from here on.
+    std::vector<Result> collect();
+    // Blocks until every submitted request has finished
+    void wait();
+
+private:
+    void workerLoop(uint32_t index);
+    Result build(const Request& request, vk::PipelineCache cache);
+    void mergeCaches();
+
+    vk::Device device;
+    vk::PipelineCache sharedCache;
+    ShaderLoader loadShader;
+    std::vector<std::thread> workers;
+    std::vector<vk::PipelineCache> workerCaches;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Request> queue;
+    uint32_t active = 0;
+    bool stopping = false;
+    bool cachesDirty = false;
+    std::vector<Result> finished;
+};
@@ -0,0 +1,151 @@
+#include "pipeline_cache.hpp"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace {
+constexpr uint32_t k_fileMagic = 0x4350524e; // "NRPC"
+constexpr uint32_t k_fileVersion = 1;
+}
+
+void PipelineCache::load(vk::Device device, const vk::PhysicalDeviceProperties& properties, const std::string& path) {
+    this->device = device;
+    this->properties = properties;
+    this->path = path;
+
+    auto data = readValidatedBlob();
+    loadedHash = data.empty() ? 0 : hash(data.data(), data.size());
+
+    vk::PipelineCacheCreateInfo createInfo{};
+    createInfo.setInitialDataSize(data.size())
+        .setPInitialData(data.empty() ? nullptr : data.data());
+    cache = device.createPipelineCache(createInfo);
+    std::cout << "Pipeline cache: " << (data.empty() ? "cold start" : "loaded " + std::to_string(data.size()) + " bytes")
+              << " (" << path << ")" << std::endl;
+}
+
+void PipelineCache::save() {
+    if (!cache || path.empty()) {
+        return;
+    }
+    auto data = device.getPipelineCacheData(cache);
+    uint64_t dataHash = hash(reinterpret_cast<const char*>(data.data()), data.size());
+    if (data.empty() || dataHash == loadedHash) {
+        return; // nothing new was compiled since the blob was loaded
+    }
+
+    FileHeader header = makeHeader(data.size(), dataHash);
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Pipeline cache: failed to open " << temporaryPath << " for writing" << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file.good()) {
+            std::cerr << "Pipeline cache: failed to write " << temporaryPath << std::endl;
+            return;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporaryPath, path, error);
+    if (error) {
+        std::cerr << "Pipeline cache: failed to replace " << path << ": " << error.message() << std::endl;
+        std::filesystem::remove(temporaryPath, error);
+        return;
+    }
+    loadedHash = dataHash;
+}
+
+void PipelineCache::destroy() {
+    if (cache) {
+        device.destroyPipelineCache(cache);
+        cache = nullptr;
+    }
+}
+
+std::vector<char> PipelineCache::readValidatedBlob() const {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        return {};
+    }
+    size_t fileSize = (size_t) file.tellg();
+    if (fileSize < sizeof(FileHeader)) {
+        std::cerr << "Pipeline cache: rejecting truncated blob" << std::endl;
+        return {};
+    }
+    file.seekg(0);
+    FileHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!isCompatible(header) || header.dataSize != fileSize - sizeof(FileHeader)) {
+        std::cerr << "Pipeline cache: rejecting blob from another device, driver or format" << std::endl;
+        return {};
+    }
+
+    std::vector<char> data(header.dataSize);
+    file.read(data.data(), data.size());
+    if (!file.good() || hash(data.data(), data.size()) != header.dataHash || !isDriverHeaderValid(data)) {
+        std::cerr << "Pipeline cache: rejecting corrupt blob" << std::endl;
+        return {};
+    }
+    return data;
+}
+
+bool PipelineCache::isCompatible(const FileHeader& header) const {
+    return header.magic == k_fileMagic
+        && header.version == k_fileVersion
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && header.driverVersion == properties.driverVersion
+        && !memcmp(header.pipelineCacheUUID, &properties.pipelineCacheUUID[0], VK_UUID_SIZE);
+}
+
+// Drivers are supposed to reject foreign data themselves, but not all of them do it gracefully,
+// so the VkPipelineCacheHeaderVersionOne at the start of the blob is checked as well.
+bool PipelineCache::isDriverHeaderValid(const std::vector<char>& data) const {
+    struct DriverHeader {
+        uint32_t headerSize;
+        uint32_t headerVersion;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+    };
+    if (data.size() < sizeof(DriverHeader)) {
+        return false;
+    }
+    DriverHeader header{};
+    memcpy(&header, data.data(), sizeof(header));
+    return header.headerSize >= sizeof(DriverHeader)
+        && header.headerSize <= data.size()
+        && header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+        && header.vendorID == properties.vendorID
+        && header.deviceID == properties.deviceID
+        && !memcmp(header.pipelineCacheUUID, &properties.pipelineCacheUUID[0], VK_UUID_SIZE);
+}
+
+PipelineCache::FileHeader PipelineCache::makeHeader(uint64_t dataSize, uint64_t dataHash) const {
+    FileHeader header{};
+    header.magic = k_fileMagic;
+    header.version = k_fileVersion;
+    header.vendorID = properties.vendorID;
+    header.deviceID = properties.deviceID;
+    header.driverVersion = properties.driverVersion;
+    memcpy(header.pipelineCacheUUID, &properties.pipelineCacheUUID[0], VK_UUID_SIZE);
+    header.dataSize = dataSize;
+    header.dataHash = dataHash;
+    return header;
+}
+
+// 64-bit FNV-1a, only used to detect corruption
+uint64_t PipelineCache::hash(const char* data, size_t size) {
+    uint64_t value = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        value ^= static_cast<uint8_t>(data[i]);
+        value *= 0x100000001b3ull;
+    }
+    return value;
+}
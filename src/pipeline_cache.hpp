@@ -0,0 +1,44 @@
+#pragma once
+#include "vulkan_common.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// vk::PipelineCache persisted on disk between launches.
+// The blob is prefixed with our own header (device, driver and checksum) on top of the
+// VkPipelineCacheHeaderVersionOne that every driver writes, and anything that does not
+// match the current device and driver is discarded instead of being handed to the driver.
+class PipelineCache {
+public:
+    void load(vk::Device device, const vk::PhysicalDeviceProperties& properties, const std::string& path);
+    // Writes the cache back to disk through a temporary file + rename, so a crash never leaves a torn blob behind.
+    void save();
+    void destroy();
+
+    vk::PipelineCache get() const { return cache; }
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+        uint64_t dataHash;
+    };
+
+    std::vector<char> readValidatedBlob() const;
+    bool isCompatible(const FileHeader& header) const;
+    bool isDriverHeaderValid(const std::vector<char>& data) const;
+    FileHeader makeHeader(uint64_t dataSize, uint64_t dataHash) const;
+    static uint64_t hash(const char* data, size_t size);
+
+    vk::Device device;
+    vk::PipelineCache cache;
+    vk::PhysicalDeviceProperties properties;
+    std::string path;
+    uint64_t loadedHash = 0;
+};
@@ -0,0 +1,130 @@
+#include "pipeline_registry.hpp"
+
+namespace {
+template <typename T>
+void append(std::string& key, const T& value) {
+    key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void appendString(std::string& key, const std::string& value) {
+    append(key, static_cast<uint32_t>(value.size()));
+    key += value;
+}
+}
+
+void PipelineRegistry::init(vk::Device device, PipelineBuilder& builder) {
+    this->device = device;
+    this->builder = &builder;
+}
+
+void PipelineRegistry::request(const GraphicsPipelineDesc& desc, const std::string& vertexShader, const std::string& fragmentShader,
+                               vk::Pipeline& target) {
+    auto [it, inserted] = entries.try_emplace(makeKey(desc, vertexShader, fragmentShader));
+    Entry& entry = it->second;
+    entry.targets.push_back(&target);
+    target = entry.pipeline;
+    if (!inserted) {
+        hits++;
+        return;
+    }
+    misses++;
+    entry.request = {desc, vertexShader, fragmentShader, &entry.pipeline};
+    entriesBySlot[&entry.pipeline] = &entry;
+    building++;
+    builder->submit({entry.request});
+}
+
+uint32_t PipelineRegistry::rebuild(const std::string& shader) {
+    std::vector<PipelineBuilder::Request> requests;
+    for (auto& [key, entry] : entries) {
+        if (entry.request.vertexShader == shader || entry.request.fragmentShader == shader) {
+            requests.push_back(entry.request);
+        }
+    }
+    uint32_t count = static_cast<uint32_t>(requests.size());
+    building += count;
+    builder->submit(std::move(requests));
+    return count;
+}
+
+PipelineRegistry::Update PipelineRegistry::update() {
+    Update update;
+    update.built = builder->collect();
+    for (auto& result : update.built) {
+        building--;
+        Entry& entry = *entriesBySlot.at(result.request.target);
+        if (!result.pipeline) {
+            continue; // a failed rebuild leaves the previous pipeline in place
+        }
+        if (entry.pipeline) {
+            update.replaced.push_back(entry.pipeline);
+        }
+        entry.pipeline = result.pipeline;
+        for (auto target : entry.targets) {
+            *target = entry.pipeline;
+        }
+    }
+    return update;
+}
+
+void PipelineRegistry::clear() {
+    if (!builder) {
+        return;
+    }
+    builder->wait();
+    for (auto& result : builder->collect()) {
+        device.destroyPipeline(result.pipeline);
+    }
+    for (auto& [key, entry] : entries) {
+        device.destroyPipeline(entry.pipeline);
+        for (auto target : entry.targets) {
+            *target = nullptr;
+        }
+    }
+    entries.clear();
+    entriesBySlot.clear();
+    building = 0;
+}
+
+size_t PipelineRegistry::KeyHash::operator()(const std::string& key) const {
+    // 64-bit FNV-1a
+    uint64_t value = 0xcbf29ce484222325ull;
+    for (char c : key) {
+        value ^= static_cast<uint8_t>(c);
+        value *= 0x100000001b3ull;
+    }
+    return static_cast<size_t>(value);
+}
+
+// The state buildGraphicsPipeline() hard-codes is the same for every pipeline and is left out
+std::string PipelineRegistry::makeKey(const GraphicsPipelineDesc& desc, const std::string& vertexShader, const std::string& fragmentShader) {
+    std::string key;
+    appendString(key, vertexShader);
+    appendString(key, fragmentShader);
+    append(key, static_cast<uint32_t>(desc.specializationConstants.size()));
+    for (uint32_t value : desc.specializationConstants) {
+        append(key, value);
+    }
+    append(key, static_cast<uint32_t>(desc.vertexBindings.size()));
+    for (const auto& binding : desc.vertexBindings) {
+        append(key, binding.binding);
+        append(key, binding.stride);
+        append(key, binding.inputRate);
+    }
+    append(key, static_cast<uint32_t>(desc.vertexAttributes.size()));
+    for (const auto& attribute : desc.vertexAttributes) {
+        append(key, attribute.location);
+        append(key, attribute.binding);
+        append(key, attribute.format);
+        append(key, attribute.offset);
+    }
+    append(key, desc.cullMode);
+    append(key, desc.frontFace);
+    append(key, desc.samples);
+    append(key, desc.depthTest);
+    append(key, static_cast<VkPipelineLayout>(desc.layout));
+    // Without a compatibility key only the exact render pass is known to work
+    append(key, desc.renderPassCompatibility ? desc.renderPassCompatibility : uint64_t(static_cast<VkRenderPass>(desc.renderPass)));
+    append(key, desc.subpass);
+    return key;
+}
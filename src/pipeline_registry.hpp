@@ -0,0 +1,64 @@
+#pragma once
+#include "vulkan_common.hpp"
+#include "pipeline_builder.hpp"
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Deduplicates graphics pipelines. Every request is reduced to a key covering the shaders, the specialization
+// constants, all per-pipeline fixed-function state, the layout and the render pass compatibility class.
+// A request matching an existing key shares that pipeline, a new key is built lazily on the PipelineBuilder.
+// The registry owns the pipelines, the targets handed to request() only ever point at them.
+class PipelineRegistry {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        size_t pipelines = 0;
+    };
+    struct Update {
+        std::vector<PipelineBuilder::Result> built; // finished builds, failures included
+        std::vector<vk::Pipeline> replaced;         // superseded by a rebuild, frames in flight may still use them
+    };
+
+    void init(vk::Device device, PipelineBuilder& builder);
+
+    // Points target at the pipeline for this description. It is set right away when an identical pipeline
+    // is already built, otherwise it stays null until update() delivers the pipeline.
+    void request(const GraphicsPipelineDesc& desc, const std::string& vertexShader, const std::string& fragmentShader,
+                 vk::Pipeline& target);
+    // Rebuilds every pipeline using the shader, the current ones keep serving until the new ones arrive
+    uint32_t rebuild(const std::string& shader);
+    // Frame boundary: hands the pipelines finished since the last call to their targets
+    Update update();
+    // Builds still queued or running
+    uint32_t pending() const { return building; }
+
+    // Device idle only: waits for the builder, destroys every pipeline and resets every target to null
+    void clear();
+    Stats stats() const { return {hits, misses, entries.size()}; }
+
+private:
+    struct Entry {
+        PipelineBuilder::Request request; // its target is the entry's own pipeline slot
+        vk::Pipeline pipeline;
+        std::vector<vk::Pipeline*> targets;
+    };
+    struct KeyHash {
+        size_t operator()(const std::string& key) const;
+    };
+
+    static std::string makeKey(const GraphicsPipelineDesc& desc, const std::string& vertexShader, const std::string& fragmentShader);
+
+    vk::Device device;
+    PipelineBuilder* builder = nullptr;
+    // Keyed by the serialized state, so equal hashes of different states never alias
+    std::unordered_map<std::string, Entry, KeyHash> entries;
+    // Results come back with the entry's pipeline slot as their target
+    std::unordered_map<const vk::Pipeline*, Entry*> entriesBySlot;
+    uint32_t building = 0;
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+};
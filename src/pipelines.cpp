@@ -0,0 +1,182 @@
+#include "pipelines.hpp"
+
+namespace {
+// 64-bit FNV-1a
+struct Hasher {
+    uint64_t value = 0xcbf29ce484222325ull;
+    template <typename T>
+    void add(const T& data) {
+        auto bytes = reinterpret_cast<const uint8_t*>(&data);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            value ^= bytes[i];
+            value *= 0x100000001b3ull;
+        }
+    }
+    void addReferences(uint32_t count, const vk::AttachmentReference* references) {
+        add(count);
+        for (uint32_t i = 0; references && i < count; i++) {
+            add(references[i].attachment); // the layout is irrelevant for compatibility
+        }
+    }
+};
+}
+
+vk::Pipeline buildGraphicsPipeline(vk::Device device, const GraphicsPipelineDesc& desc, vk::PipelineCache pipelineCache) {
+    vk::PipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.stage = vk::ShaderStageFlagBits::eVertex;
+    vertShaderStageInfo.module = desc.vertexShader;
+    vertShaderStageInfo.pName = "main";
+
+    vk::PipelineShaderStageCreateInfo fragShaderStageInfo{};
+    fragShaderStageInfo.stage = vk::ShaderStageFlagBits::eFragment;
+    fragShaderStageInfo.module = desc.fragmentShader;
+    fragShaderStageInfo.pName = "main";
+
+    std::vector<vk::SpecializationMapEntry> specializationEntries;
+    for (uint32_t i = 0; i < desc.specializationConstants.size(); i++) {
+        specializationEntries.emplace_back(i, i * static_cast<uint32_t>(sizeof(uint32_t)), sizeof(uint32_t));
+    }
+    vk::SpecializationInfo specializationInfo{};
+    specializationInfo.setMapEntryCount(static_cast<uint32_t>(specializationEntries.size()))
+        .setPMapEntries(specializationEntries.data())
+        .setDataSize(desc.specializationConstants.size() * sizeof(uint32_t))
+        .setPData(desc.specializationConstants.data());
+    if (!desc.specializationConstants.empty()) {
+        vertShaderStageInfo.pSpecializationInfo = &specializationInfo;
+        fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+    }
+
+    vk::PipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+
+    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.setVertexBindingDescriptionCount(static_cast<uint32_t>(desc.vertexBindings.size()))
+                   .setVertexAttributeDescriptionCount(static_cast<uint32_t>(desc.vertexAttributes.size()));
+    vertexInputInfo.pVertexBindingDescriptions = desc.vertexBindings.data();
+    vertexInputInfo.pVertexAttributeDescriptions = desc.vertexAttributes.data();
+
+    vk::PipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
+    inputAssembly.primitiveRestartEnable = false;
+
+    // Viewport and scissor are dynamic state (see dynamicStates below), so only their count is baked into the pipeline.
+    // This keeps the pipeline independent of the swapchain extent and lets it survive window resizes.
+    vk::PipelineViewportStateCreateInfo viewportState({}, 1, nullptr, 1, nullptr);
+
+    vk::PipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.setDepthClampEnable(false) // fragments that are beyond the near and far planes are clamped to them
+        .setRasterizerDiscardEnable(false) // if true geometry never passes through the rasterizer stage. This basically disables any output to the framebuffer
+        .setPolygonMode(vk::PolygonMode::eFill) // Using any mode other than fill requires enabling a GPU feature.
+        .setLineWidth(1.0f)
+        .setCullMode(desc.cullMode)
+        .setFrontFace(desc.frontFace)
+        .setDepthBiasEnable(false) //to alter the depth values by adding a constant value or biasing them based on a fragment's slope. This is sometimes used for shadow mapping.
+        .setDepthBiasConstantFactor(0.0f)
+        .setDepthBiasClamp(0.0f)
+        .setDepthBiasSlopeFactor(0.0f);
+
+    vk::PipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.setSampleShadingEnable(false) // configures multisampling, which is one of the ways to perform anti-aliasing
+        .setRasterizationSamples(desc.samples)
+        .setMinSampleShading(1.0f)
+        .setPSampleMask(nullptr)
+        .setAlphaToCoverageEnable(false)
+        .setAlphaToOneEnable(false);
+
+    // Ignored by render passes without a depth attachment, so every pipeline can carry it
+    vk::PipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.setDepthTestEnable(desc.depthTest)
+        .setDepthWriteEnable(desc.depthTest)
+        .setDepthCompareOp(vk::CompareOp::eLess) // the projection maps the near plane to 0 and the far plane to 1
+        .setDepthBoundsTestEnable(false)
+        .setStencilTestEnable(false);
+
+    // color blending settings per framebuffer
+    vk::PipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.setColorWriteMask(vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                                           vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA)
+        .setBlendEnable(false)
+        .setSrcColorBlendFactor(vk::BlendFactor::eOne)
+        .setDstColorBlendFactor(vk::BlendFactor::eZero)
+        .setColorBlendOp(vk::BlendOp::eAdd)
+        .setSrcAlphaBlendFactor(vk::BlendFactor::eOne)
+        .setDstAlphaBlendFactor(vk::BlendFactor::eZero)
+        .setAlphaBlendOp(vk::BlendOp::eAdd);
+    // Pseudocode for color blending:
+    // if (blendEnable) {
+    //     finalColor.rgb = (srcColorBlendFactor * newColor.rgb) <colorBlendOp> (dstColorBlendFactor * oldColor.rgb);
+    //     finalColor.a = (srcAlphaBlendFactor * newColor.a) <alphaBlendOp> (dstAlphaBlendFactor * oldColor.a);
+    // } else {
+    //     finalColor = newColor;
+    // }
+    // finalColor = finalColor & colorWriteMask;
+
+    // global color blending settings -> for all framebuffers
+    vk::PipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.setLogicOpEnable(false)
+        .setLogicOp(vk::LogicOp::eCopy)
+        .setAttachmentCount(1)
+        .setPAttachments(&colorBlendAttachment)
+        .setBlendConstants({0.0f, 0.0f, 0.0f, 0.0f});
+
+    vk::DynamicState dynamicStates[] = {
+        vk::DynamicState::eViewport,
+        vk::DynamicState::eScissor
+    };
+    vk::PipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.setDynamicStateCount(2)
+        .setPDynamicStates(dynamicStates);
+
+    vk::GraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.setStageCount(2)
+        .setPStages(shaderStages)
+        .setPVertexInputState(&vertexInputInfo)
+        .setPInputAssemblyState(&inputAssembly)
+        .setPViewportState(&viewportState)
+        .setPRasterizationState(&rasterizer)
+        .setPMultisampleState(&multisampling)
+        .setPDepthStencilState(&depthStencil)
+        .setPColorBlendState(&colorBlending)
+        .setPDynamicState(&dynamicState)
+        .setLayout(desc.layout)
+        .setRenderPass(desc.renderPass) // It is also possible to use other render passes with this pipeline instead of this specific instance, but they have to be compatible
+        .setSubpass(desc.subpass)  // index of the sub pass where this graphics pipeline will be used
+        // Vulkan allows you to create a new graphics pipeline by deriving from an existing pipeline.
+        // The idea of pipeline derivatives is that it is less expensive to set up pipelines when they have much functionality
+        // in common with an existing pipeline and switching between pipelines from the same parent can also be done quicker
+        .setBasePipelineHandle(nullptr)
+        .setBasePipelineIndex(-1);
+
+    return device.createGraphicsPipeline(pipelineCache, pipelineInfo);
+}
+
+uint64_t renderPassCompatibilityKey(const vk::RenderPassCreateInfo& createInfo) {
+    Hasher hasher;
+    hasher.add(createInfo.attachmentCount);
+    for (uint32_t i = 0; i < createInfo.attachmentCount; i++) {
+        const auto& attachment = createInfo.pAttachments[i];
+        hasher.add(attachment.format);
+        hasher.add(attachment.samples);
+        hasher.add(attachment.flags);
+    }
+    hasher.add(createInfo.subpassCount);
+    for (uint32_t i = 0; i < createInfo.subpassCount; i++) {
+        const auto& subpass = createInfo.pSubpasses[i];
+        hasher.add(subpass.pipelineBindPoint);
+        hasher.addReferences(subpass.inputAttachmentCount, subpass.pInputAttachments);
+        hasher.addReferences(subpass.colorAttachmentCount, subpass.pColorAttachments);
+        hasher.addReferences(subpass.pResolveAttachments ? subpass.colorAttachmentCount : 0, subpass.pResolveAttachments);
+        hasher.addReferences(subpass.pDepthStencilAttachment ? 1 : 0, subpass.pDepthStencilAttachment);
+    }
+    hasher.add(createInfo.dependencyCount);
+    for (uint32_t i = 0; i < createInfo.dependencyCount; i++) {
+        const auto& dependency = createInfo.pDependencies[i];
+        hasher.add(dependency.srcSubpass);
+        hasher.add(dependency.dstSubpass);
+        hasher.add(dependency.srcStageMask);
+        hasher.add(dependency.dstStageMask);
+        hasher.add(dependency.srcAccessMask);
+        hasher.add(dependency.dstAccessMask);
+        hasher.add(dependency.dependencyFlags);
+    }
+    return hasher.value;
+}
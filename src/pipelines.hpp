@@ -0,0 +1,33 @@
+#pragma once
+#include "vulkan_common.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Everything that varies between the graphics pipelines of the renderer. The remaining fixed-function state
+// (dynamic viewport/scissor, no blending, no stencil) is shared by all of them.
+struct GraphicsPipelineDesc {
+    vk::ShaderModule vertexShader;
+    vk::ShaderModule fragmentShader;
+    std::vector<vk::VertexInputBindingDescription> vertexBindings;
+    std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+    vk::CullModeFlags cullMode = vk::CullModeFlagBits::eBack;
+    vk::FrontFace frontFace = vk::FrontFace::eClockwise;
+    // Has to match the attachments of the render pass
+    vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+    // Less-than depth test and depth writes, against a depth buffer cleared to 1
+    bool depthTest = false;
+    // Both stages see the same values, constant_id i takes specializationConstants[i]
+    std::vector<uint32_t> specializationConstants;
+    vk::PipelineLayout layout;
+    vk::RenderPass renderPass;
+    // The pipeline works with every render pass sharing this key, see renderPassCompatibilityKey()
+    uint64_t renderPassCompatibility = 0;
+    uint32_t subpass = 0;
+};
+
+vk::Pipeline buildGraphicsPipeline(vk::Device device, const GraphicsPipelineDesc& desc, vk::PipelineCache pipelineCache);
+
+// Hash of what makes two render passes compatible: attachment formats and sample counts, the attachment
+// references of every subpass and the dependencies. Layouts and load/store operations do not matter.
+uint64_t renderPassCompatibilityKey(const vk::RenderPassCreateInfo& createInfo);
@@ -0,0 +1,93 @@
+#include "present_policy.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+PresentPolicy parsePresentPolicy(const std::string& name) {
+    for (auto policy : {PresentPolicy::LowLatency, PresentPolicy::Smooth, PresentPolicy::Uncapped, PresentPolicy::PowerSave,
+                        PresentPolicy::Default}) {
+        if (name == presentPolicyName(policy)) {
+            return policy;
+        }
+    }
+    throw std::runtime_error("unknown present policy " + name + ", expected low-latency, smooth, uncapped, power-save or default!");
+}
+
+const char* presentPolicyName(PresentPolicy policy) {
+    switch (policy) {
+    case PresentPolicy::LowLatency:
+        return "low-latency";
+    case PresentPolicy::Smooth:
+        return "smooth";
+    case PresentPolicy::Uncapped:
+        return "uncapped";
+    case PresentPolicy::PowerSave:
+        return "power-save";
+    case PresentPolicy::Default:
+        return "default";
+    }
+    return "unknown";
+}
+
+vk::PresentModeKHR choosePresentMode(PresentPolicy policy, const std::vector<vk::PresentModeKHR>& availablePresentModes) {
+    auto available = [&](vk::PresentModeKHR mode) {
+        return std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end();
+    };
+    if (policy == PresentPolicy::Uncapped || policy == PresentPolicy::Default) {
+        if (available(vk::PresentModeKHR::eMailbox)) {
+            return vk::PresentModeKHR::eMailbox;
+        }
+        // Only an explicit request for uncapped accepts tearing, the default stays on vsync
+        if (policy == PresentPolicy::Uncapped && available(vk::PresentModeKHR::eImmediate)) {
+            return vk::PresentModeKHR::eImmediate;
+        }
+    }
+    return vk::PresentModeKHR::eFifo; // the only mode every device has to support
+}
+
+uint32_t chooseImageCount(PresentPolicy policy, const vk::SurfaceCapabilitiesKHR& capabilities) {
+    uint32_t imageCount = capabilities.minImageCount;
+    switch (policy) {
+    case PresentPolicy::Smooth:
+        imageCount = std::max(imageCount, 3u);
+        break;
+    case PresentPolicy::Uncapped:
+    case PresentPolicy::Default:
+        imageCount++; // a spare image to render into while one is shown and one is queued
+        break;
+    default:
+        break; // every additional image is another frame that can queue up in front of the display
+    }
+    if (capabilities.maxImageCount > 0) {
+        imageCount = std::min(imageCount, capabilities.maxImageCount);
+    }
+    return imageCount;
+}
+
+uint32_t defaultFramesInFlight(PresentPolicy policy) {
+    return policy == PresentPolicy::LowLatency ? 1 : 2;
+}
+
+void FrameLimiter::setTargetFps(double fps) {
+    interval = fps > 0.0 ? std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / fps)) : clock::duration{};
+    deadline = clock::now();
+}
+
+void FrameLimiter::wait() {
+    if (!isEnabled()) {
+        return;
+    }
+    deadline += interval;
+    auto now = clock::now();
+    if (deadline <= now) {
+        deadline = now;
+        return;
+    }
+    if (deadline - now > k_spinTime) {
+        std::this_thread::sleep_until(deadline - k_spinTime);
+    }
+    while (clock::now() < deadline) {
+        std::this_thread::yield();
+    }
+}
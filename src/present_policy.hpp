@@ -0,0 +1,44 @@
+#pragma once
+#include "vulkan_common.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How frames are handed to the presentation engine, trading latency against smoothness and power:
+//   low-latency: FIFO with the fewest swapchain images and one frame in flight, the CPU only starts a frame
+//                (and samples its input) once the GPU has finished the previous one
+//   smooth:      FIFO with triple buffering, absorbs frame time spikes at the cost of up to a frame of latency
+//   uncapped:    MAILBOX or IMMEDIATE, renders as fast as possible and tears when only IMMEDIATE is available
+//   power-save:  FIFO paced by a CPU frame limiter, so neither the CPU nor the GPU run ahead of the target rate
+//   default:     MAILBOX when available, otherwise FIFO, the selection from before there were policies
+enum class PresentPolicy { LowLatency, Smooth, Uncapped, PowerSave, Default };
+
+PresentPolicy parsePresentPolicy(const std::string& name);
+const char* presentPolicyName(PresentPolicy policy);
+
+vk::PresentModeKHR choosePresentMode(PresentPolicy policy, const std::vector<vk::PresentModeKHR>& availablePresentModes);
+uint32_t chooseImageCount(PresentPolicy policy, const vk::SurfaceCapabilitiesKHR& capabilities);
+// Used unless --frames-in-flight overrides it
+uint32_t defaultFramesInFlight(PresentPolicy policy);
+
+// Holds the frame loop to a target rate. Sleeps through most of the interval and spins the rest,
+// since a sleep can overshoot by a scheduler tick.
+class FrameLimiter {
+public:
+    static constexpr double k_powerSaveFps = 30.0;
+
+    // 0 disables the limiter
+    void setTargetFps(double fps);
+    bool isEnabled() const { return interval.count() > 0; }
+    // Blocks until the next frame is due. A frame that missed its slot starts right away without the next ones catching up.
+    void wait();
+
+private:
+    using clock = std::chrono::steady_clock;
+    static constexpr std::chrono::microseconds k_spinTime{1500};
+
+    clock::duration interval{};
+    clock::time_point deadline{};
+};
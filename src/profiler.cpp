@@ -0,0 +1,198 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+
+void Profiler::setEnabled(bool enabled) {
+    if (enabled && !ring) {
+        ring.reset(new Slot[k_ringCapacity]);
+    }
+    this->enabled = enabled;
+}
+
+void Profiler::recordCpu(const char* name, uint64_t startNs, uint64_t endNs) {
+    push({name, startNs, endNs - startNs, currentFrame.load(std::memory_order_relaxed), threadIndex()});
+}
+
+// Multiple producers claim slots with a single fetch_add. Readers only trust slots whose sequence
+// matches the index they expect, so an event being overwritten is skipped instead of read torn.
+void Profiler::push(const Event& event) {
+    uint64_t index = writeIndex.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = ring[index & (k_ringCapacity - 1)];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.event = event;
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+std::vector<Profiler::Event> Profiler::snapshot() const {
+    if (!ring) {
+        return {};
+    }
+    uint64_t end = writeIndex.load(std::memory_order_acquire);
+    uint64_t begin = end > k_ringCapacity ? end - k_ringCapacity : 0;
+    std::vector<Event> events;
+    events.reserve(end - begin);
+    for (uint64_t index = begin; index < end; index++) {
+        const Slot& slot = ring[index & (k_ringCapacity - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+            continue;
+        }
+        Event event = slot.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) == index + 1) {
+            events.push_back(event);
+        }
+    }
+    return events;
+}
+
+uint32_t Profiler::threadIndex() {
+    static std::atomic<uint32_t> nextThread{1}; // 0 is the GPU track
+    thread_local uint32_t index = nextThread.fetch_add(1);
+    return index;
+}
+
+void Profiler::initGpu(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameSlots) {
+    if (!enabled) {
+        return;
+    }
+    uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+    if (validBits == 0) {
+        std::cerr << "Profiler: queue family " << queueFamilyIndex << " has no timestamp support, GPU scopes disabled" << std::endl;
+        return;
+    }
+    this->device = device;
+    timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+    timestampPeriodNs = physicalDevice.getProperties().limits.timestampPeriod;
+    gpuFrames.assign(frameSlots, GpuFrame{});
+
+    vk::QueryPoolCreateInfo createInfo{};
+    createInfo.setQueryType(vk::QueryType::eTimestamp)
+        .setQueryCount(frameSlots * k_maxGpuScopesPerFrame * 2);
+    queryPool = device.createQueryPool(createInfo);
+}
+
+void Profiler::destroyGpu() {
+    if (queryPool) {
+        device.destroyQueryPool(queryPool);
+        queryPool = nullptr;
+    }
+    gpuFrames.clear();
+}
+
+void Profiler::beginGpuFrame(vk::CommandBuffer commandBuffer, uint32_t slot) {
+    if (!queryPool) {
+        return;
+    }
+    collectGpuFrame(slot);
+    recordingSlot = slot;
+    gpuFrames[slot].scopeCount = 0;
+    commandBuffer.resetQueryPool(queryPool, slot * k_maxGpuScopesPerFrame * 2, k_maxGpuScopesPerFrame * 2);
+}
+
+uint32_t Profiler::beginGpuScope(vk::CommandBuffer commandBuffer, const char* name) {
+    if (!queryPool) {
+        return UINT32_MAX;
+    }
+    GpuFrame& frame = gpuFrames[recordingSlot];
+    if (frame.scopeCount == k_maxGpuScopesPerFrame) {
+        return UINT32_MAX;
+    }
+    uint32_t scope = frame.scopeCount++;
+    frame.names[scope] = name;
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, (recordingSlot * k_maxGpuScopesPerFrame + scope) * 2);
+    return scope;
+}
+
+void Profiler::endGpuScope(vk::CommandBuffer commandBuffer, uint32_t token) {
+    if (token == UINT32_MAX) {
+        return;
+    }
+    commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, (recordingSlot * k_maxGpuScopesPerFrame + token) * 2 + 1);
+}
+
+void Profiler::gpuFrameSubmitted(uint32_t slot, uint64_t frame) {
+    if (!queryPool) {
+        return;
+    }
+    gpuFrames[slot].frame = frame;
+    gpuFrames[slot].submitNs = now();
+    gpuFrames[slot].pending = gpuFrames[slot].scopeCount > 0;
+}
+
+void Profiler::collectGpuFrame(uint32_t slot) {
+    GpuFrame& frame = gpuFrames[slot];
+    if (!frame.pending) {
+        return;
+    }
+    frame.pending = false;
+    uint64_t timestamps[k_maxGpuScopesPerFrame * 2];
+    uint32_t count = frame.scopeCount * 2;
+    // No eWait: the frame pacer already guaranteed the frame completed, a not-ready result is simply dropped
+    auto result = device.getQueryPoolResults(queryPool, slot * k_maxGpuScopesPerFrame * 2, count,
+                                             count * sizeof(uint64_t), timestamps, sizeof(uint64_t),
+                                             vk::QueryResultFlagBits::e64);
+    if (result != vk::Result::eSuccess) {
+        return;
+    }
+    // GPU ticks have no relation to the CPU clock, the first timestamp of the frame is pinned to its submit time
+    uint64_t base = timestamps[0] & timestampMask;
+    for (uint32_t scope = 0; scope < frame.scopeCount; scope++) {
+        uint64_t begin = timestamps[scope * 2] & timestampMask;
+        uint64_t end = timestamps[scope * 2 + 1] & timestampMask;
+        auto startNs = frame.submitNs + static_cast<uint64_t>((begin - base) * timestampPeriodNs);
+        auto durationNs = static_cast<uint64_t>(((end - begin) & timestampMask) * timestampPeriodNs);
+        push({frame.names[scope], startNs, durationNs, frame.frame, static_cast<uint32_t>(Track::Gpu)});
+    }
+}
+
+void Profiler::writeChromeTrace(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open " + path + " for writing!");
+    }
+    auto events = snapshot();
+    uint64_t origin = events.empty() ? 0 : std::min_element(events.begin(), events.end(), [](const Event& a, const Event& b) {
+        return a.startNs < b.startNs;
+    })->startNs;
+
+    file << "{\"traceEvents\":[\n";
+    file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":0,\"args\":{\"name\":\"GPU\"}}";
+    for (const auto& event : events) {
+        file << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.thread
+             << ",\"ts\":" << (event.startNs - origin) / 1000.0
+             << ",\"dur\":" << event.durationNs / 1000.0
+             << ",\"args\":{\"frame\":" << event.frame << "}}";
+    }
+    file << "\n]}\n";
+}
+
+void Profiler::writePercentileCsv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open " + path + " for writing!");
+    }
+    std::map<std::string, std::vector<double>> durations;
+    for (const auto& event : snapshot()) {
+        std::string key = (event.thread == static_cast<uint32_t>(Track::Gpu) ? "gpu:" : "cpu:") + std::string(event.name);
+        durations[key].push_back(event.durationNs / 1e6);
+    }
+    auto percentile = [](const std::vector<double>& sorted, double p) {
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * (sorted.size() - 1) + 0.5))];
+    };
+    file << "scope,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+    for (auto& [name, values] : durations) {
+        std::sort(values.begin(), values.end());
+        double sum = 0.0;
+        for (double value : values) {
+            sum += value;
+        }
+        file << name << "," << values.size() << "," << sum / values.size() << ","
+             << percentile(values, 0.5) << "," << percentile(values, 0.9) << ","
+             << percentile(values, 0.99) << "," << values.back() << "\n";
+    }
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "vulkan_common.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Frame profiler: CPU scopes and GPU timestamp pairs go into a lock-free ring buffer,
+// which can be dumped as a Chrome trace (chrome://tracing, Perfetto) or as a CSV of percentiles per scope.
+// Everything is a no-op behind a single branch while the profiler is disabled.
+class Profiler {
+public:
+    static constexpr uint32_t k_ringCapacity = 1u << 16; // must be a power of two
+    static constexpr uint32_t k_maxGpuScopesPerFrame = 8;
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    static uint64_t now() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    // Scope names must be string literals (or otherwise outlive the profiler), only the pointer is stored.
+    void recordCpu(const char* name, uint64_t startNs, uint64_t endNs);
+    void setFrame(uint64_t frame) { currentFrame.store(frame, std::memory_order_relaxed); }
+
+    // GPU timestamps, one query range per frame slot. Stays disabled if the queue has no timestamp support.
+    void initGpu(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t frameSlots);
+    void destroyGpu();
+    // Collects the results of the slot's previous frame (which must have completed) and resets its queries.
+    // Has to be recorded outside of a render pass.
+    void beginGpuFrame(vk::CommandBuffer commandBuffer, uint32_t slot);
+    // Returns a token for endGpuScope, or UINT32_MAX when nothing was written
+    uint32_t beginGpuScope(vk::CommandBuffer commandBuffer, const char* name);
+    void endGpuScope(vk::CommandBuffer commandBuffer, uint32_t token);
+    // CPU time at which the frame was handed to the queue, used to place the GPU scopes on the CPU timeline
+    void gpuFrameSubmitted(uint32_t slot, uint64_t frame);
+
+    void writeChromeTrace(const std::string& path) const;
+    void writePercentileCsv(const std::string& path) const;
+
+private:
+    enum class Track : uint32_t { Gpu = 0 };
+
+    struct Event {
+        const char* name;
+        uint64_t startNs;
+        uint64_t durationNs;
+        uint64_t frame;
+        uint32_t thread; // CPU thread id, or Track::Gpu for GPU scopes
+    };
+    struct Slot {
+        std::atomic<uint64_t> sequence{0}; // index + 1 once the event is completely written
+        Event event;
+    };
+    struct GpuFrame {
+        const char* names[k_maxGpuScopesPerFrame];
+        uint32_t scopeCount = 0;
+        uint64_t frame = 0;
+        uint64_t submitNs = 0;
+        bool pending = false;
+    };
+
+    void push(const Event& event);
+    void collectGpuFrame(uint32_t slot);
+    std::vector<Event> snapshot() const;
+    static uint32_t threadIndex();
+
+    bool enabled = false;
+    std::atomic<uint64_t> currentFrame{0};
+    std::atomic<uint64_t> writeIndex{0};
+    std::unique_ptr<Slot[]> ring; // only allocated once enabled
+
+    vk::Device device;
+    vk::QueryPool queryPool;
+    double timestampPeriodNs = 1.0;
+    uint64_t timestampMask = ~0ull;
+    std::vector<GpuFrame> gpuFrames;
+    uint32_t recordingSlot = 0;
+};
+
+// Measures the enclosing scope on the calling thread
+class ProfileScope {
+public:
+    ProfileScope(Profiler& profiler, const char* name)
+        : profiler(profiler), name(name), startNs(profiler.isEnabled() ? Profiler::now() : 0) {}
+    ~ProfileScope() {
+        if (profiler.isEnabled()) {
+            profiler.recordCpu(name, startNs, Profiler::now());
+        }
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler& profiler;
+    const char* name;
+    uint64_t startNs;
+};
@@ -0,0 +1,566 @@
+#include "render_graph.hpp"
+#include "pipelines.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+namespace {
+bool isDepthFormat(vk::Format format) {
+    switch (format) {
+    case vk::Format::eD16Unorm:
+    case vk::Format::eX8D24UnormPack32:
+    case vk::Format::eD32Sfloat:
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return true;
+    default:
+        return false;
+    }
+}
+
+vk::ImageAspectFlags aspectFor(vk::Format format) {
+    switch (format) {
+    case vk::Format::eD16UnormS8Uint:
+    case vk::Format::eD24UnormS8Uint:
+    case vk::Format::eD32SfloatS8Uint:
+        return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+    default:
+        return isDepthFormat(format) ? vk::ImageAspectFlags(vk::ImageAspectFlagBits::eDepth)
+                                     : vk::ImageAspectFlags(vk::ImageAspectFlagBits::eColor);
+    }
+}
+
+bool isWrite(vk::AccessFlags access) {
+    const vk::AccessFlags writes = vk::AccessFlagBits::eColorAttachmentWrite | vk::AccessFlagBits::eDepthStencilAttachmentWrite |
+                                   vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+    return static_cast<bool>(access & writes);
+}
+
+vk::Extent2D scaleExtent(vk::Extent2D extent, float scale) {
+    return {std::max(1u, static_cast<uint32_t>(extent.width * scale)), std::max(1u, static_cast<uint32_t>(extent.height * scale))};
+}
+}
+
+void RenderGraph::init(vk::Device device, DeviceAllocator& allocator, Profiler& profiler) {
+    this->device = device;
+    this->allocator = &allocator;
+    this->profiler = &profiler;
+}
+
+RenderGraph::ResourceId RenderGraph::importBackbuffer(const char* name, vk::Format format, vk::ImageLayout finalLayout) {
+    Resource resource{};
+    resource.name = name;
+    resource.format = format;
+    resource.imported = true;
+    resource.final.layout = finalLayout;
+    switch (finalLayout) {
+    case vk::ImageLayout::ePresentSrcKHR:
+        // The present waits on a semaphore, which already covers every prior write
+        resource.final.stages = vk::PipelineStageFlagBits::eBottomOfPipe;
+        break;
+    case vk::ImageLayout::eTransferSrcOptimal:
+        resource.final.stages = vk::PipelineStageFlagBits::eTransfer;
+        resource.final.access = vk::AccessFlagBits::eTransferRead;
+        break;
+    default:
+        resource.final.stages = vk::PipelineStageFlagBits::eAllCommands;
+        resource.final.access = vk::AccessFlagBits::eMemoryRead;
+        break;
+    }
+    backbuffer = static_cast<ResourceId>(resources.size());
+    resources.push_back(resource);
+    return backbuffer;
+}
+
+RenderGraph::ResourceId RenderGraph::createImage(const char* name, vk::Format format, float scale, vk::SampleCountFlagBits samples) {
+    Resource resource{};
+    resource.name = name;
+    resource.format = format;
+    resource.scale = scale;
+    resource.samples = samples;
+    resources.push_back(resource);
+    return static_cast<ResourceId>(resources.size() - 1);
+}
+
+RenderGraph::PassId RenderGraph::addPass(const char* name, RecordFunction record, vk::SubpassContents contents) {
+    Pass pass{};
+    pass.name = name;
+    pass.record = std::move(record);
+    pass.contents = contents;
+    passes.push_back(std::move(pass));
+    return static_cast<PassId>(passes.size() - 1);
+}
+
+void RenderGraph::write(PassId pass, ResourceId resource, std::optional<vk::ClearValue> clear) {
+    Access access = isDepthFormat(resources[resource].format) ? Access::DepthAttachment : Access::ColorAttachment;
+    passes[pass].uses.push_back({resource, access, clear});
+}
+
+void RenderGraph::read(PassId pass, ResourceId resource) {
+    passes[pass].uses.push_back({resource, Access::Sampled, std::nullopt});
+}
+
+void RenderGraph::resolve(PassId pass, ResourceId source, ResourceId target) {
+    auto& uses = passes[pass].uses;
+    bool sourceWritten = std::any_of(uses.begin(), uses.end(), [&](const Use& use) {
+        return use.resource == source && use.access == Access::ColorAttachment && !use.isResolve();
+    });
+    if (!sourceWritten || resources[source].samples == vk::SampleCountFlagBits::e1 || resources[target].samples != vk::SampleCountFlagBits::e1) {
+        throw std::runtime_error(std::string("render graph pass ") + passes[pass].name +
+                                 " can only resolve a multisampled color attachment it writes into a single-sampled image!");
+    }
+    // Resolves happen in the color attachment output stage, the target is used like any other color attachment
+    uses.push_back({target, Access::ColorAttachment, std::nullopt, source});
+}
+
+RenderGraph::State RenderGraph::stateFor(Access access) {
+    switch (access) {
+    case Access::ColorAttachment:
+        return {vk::ImageLayout::eColorAttachmentOptimal, vk::PipelineStageFlagBits::eColorAttachmentOutput,
+                vk::AccessFlagBits::eColorAttachmentRead | vk::AccessFlagBits::eColorAttachmentWrite};
+    case Access::DepthAttachment:
+        return {vk::ImageLayout::eDepthStencilAttachmentOptimal,
+                vk::PipelineStageFlagBits::eEarlyFragmentTests | vk::PipelineStageFlagBits::eLateFragmentTests,
+                vk::AccessFlagBits::eDepthStencilAttachmentRead | vk::AccessFlagBits::eDepthStencilAttachmentWrite};
+    case Access::Sampled:
+        return {vk::ImageLayout::eShaderReadOnlyOptimal, vk::PipelineStageFlagBits::eFragmentShader, vk::AccessFlagBits::eShaderRead};
+    }
+    throw std::runtime_error("unknown render graph access!");
+}
+
+void RenderGraph::compile() {
+    if (backbuffer == UINT32_MAX) {
+        throw std::runtime_error("render graph has no backbuffer!");
+    }
+    cull();
+
+    for (PassId index = 0; index < passes.size(); index++) {
+        if (passes[index].culled) {
+            continue;
+        }
+        for (const auto& use : passes[index].uses) {
+            Resource& resource = resources[use.resource];
+            if (resource.firstPass < 0) {
+                resource.firstPass = static_cast<int32_t>(index);
+            }
+            resource.lastPass = static_cast<int32_t>(index);
+            resource.usage |= use.access == Access::ColorAttachment ? vk::ImageUsageFlagBits::eColorAttachment
+                            : use.access == Access::DepthAttachment ? vk::ImageUsageFlagBits::eDepthStencilAttachment
+                                                                    : vk::ImageUsageFlagBits::eSampled;
+        }
+    }
+
+    // Walks the surviving passes in order and emits a barrier wherever a layout changes or a write is involved
+    std::vector<State> states(resources.size());
+    std::vector<bool> touched(resources.size(), false);
+    // The acquire semaphore is waited on at the color attachment stage, chaining the first transition to it
+    states[backbuffer].stages = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+    for (PassId index = 0; index < passes.size(); index++) {
+        Pass& pass = passes[index];
+        if (pass.culled) {
+            continue;
+        }
+        for (const auto& use : pass.uses) {
+            State& current = states[use.resource];
+            State next = stateFor(use.access);
+            if (!resources[use.resource].imported && !touched[use.resource]) {
+                // The memory may have belonged to another image a moment ago, the contents are undefined either way
+                pass.barriers.push_back({use.resource, {}, next, true});
+            } else if (current.layout != next.layout || isWrite(current.access) || isWrite(next.access)) {
+                pass.barriers.push_back({use.resource, current, next});
+            }
+            touched[use.resource] = true;
+            current = next;
+        }
+        createRenderPass(index);
+    }
+    for (ResourceId id = 0; id < resources.size(); id++) {
+        if (!resources[id].imported) {
+            resources[id].final = states[id];
+        }
+    }
+    const State& output = resources[backbuffer].final;
+    if (states[backbuffer].layout != output.layout || isWrite(states[backbuffer].access)) {
+        finalBarriers.push_back({backbuffer, states[backbuffer], output});
+    }
+}
+
+// Walks the passes backwards from the backbuffer: a pass survives when one of its attachments is still
+// needed by a later surviving pass. Clearing or resolving into an attachment makes whatever earlier passes wrote to it irrelevant.
+void RenderGraph::cull() {
+    std::vector<bool> needed(resources.size(), false);
+    needed[backbuffer] = true;
+    for (size_t index = passes.size(); index-- > 0;) {
+        Pass& pass = passes[index];
+        pass.culled = true;
+        for (const auto& use : pass.uses) {
+            if (use.access != Access::Sampled && needed[use.resource]) {
+                pass.culled = false;
+            }
+        }
+        if (pass.culled) {
+            continue;
+        }
+        for (const auto& use : pass.uses) {
+            if (use.access != Access::Sampled && use.discards()) {
+                needed[use.resource] = false;
+            }
+        }
+        for (const auto& use : pass.uses) {
+            if (use.access == Access::Sampled) {
+                needed[use.resource] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::createRenderPass(PassId index) {
+    Pass& pass = passes[index];
+    // Whether a surviving pass after this one still looks at the contents
+    auto usedLater = [&](ResourceId resource) {
+        for (PassId later = index + 1; later < passes.size(); later++) {
+            if (passes[later].culled) {
+                continue;
+            }
+            for (const auto& use : passes[later].uses) {
+                if (use.resource == resource) {
+                    return use.access == Access::Sampled || !use.discards();
+                }
+            }
+        }
+        return false;
+    };
+    auto writtenBefore = [&](ResourceId resource) {
+        for (PassId earlier = 0; earlier < index; earlier++) {
+            if (passes[earlier].culled) {
+                continue;
+            }
+            for (const auto& use : passes[earlier].uses) {
+                if (use.resource == resource && use.access != Access::Sampled) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    };
+
+    std::vector<vk::AttachmentDescription> descriptions;
+    std::vector<vk::AttachmentReference> colorReferences;
+    std::vector<ResourceId> colorResources;
+    std::vector<std::pair<ResourceId, vk::AttachmentReference>> resolves; // source, target
+    std::optional<vk::AttachmentReference> depthReference;
+    for (const auto& use : pass.uses) {
+        if (use.access == Access::Sampled) {
+            continue;
+        }
+        const Resource& resource = resources[use.resource];
+        if (pass.attachments.empty()) {
+            pass.scale = resource.scale;
+        } else if (resource.scale != pass.scale) {
+            throw std::runtime_error(std::string("render graph pass ") + pass.name + " mixes attachment sizes!");
+        }
+        if (resource.imported) {
+            pass.rendersToBackbuffer = true;
+        }
+        // Contents nobody reads again are never written back to memory, which keeps them in tile memory on tilers.
+        // A multisampled attachment that is resolved in the pass therefore only ever exists on chip.
+        vk::AttachmentLoadOp loadOp = use.clear ? vk::AttachmentLoadOp::eClear
+                                    : !use.isResolve() && writtenBefore(use.resource) ? vk::AttachmentLoadOp::eLoad
+                                                                                     : vk::AttachmentLoadOp::eDontCare;
+        vk::AttachmentStoreOp storeOp = resource.imported || usedLater(use.resource) ? vk::AttachmentStoreOp::eStore
+                                                                                      : vk::AttachmentStoreOp::eDontCare;
+        vk::ImageLayout layout = stateFor(use.access).layout;
+        vk::AttachmentDescription description{};
+        description.setFormat(resource.format)
+            .setSamples(resource.samples)
+            .setLoadOp(loadOp)
+            .setStoreOp(storeOp)
+            .setStencilLoadOp(loadOp)
+            .setStencilStoreOp(storeOp)
+            .setInitialLayout(layout) // the barriers recorded before the pass do the transitions
+            .setFinalLayout(layout);
+        vk::AttachmentReference reference(static_cast<uint32_t>(descriptions.size()), layout);
+        if (use.access == Access::DepthAttachment) {
+            if (depthReference) {
+                throw std::runtime_error(std::string("render graph pass ") + pass.name + " writes two depth attachments!");
+            }
+            depthReference = reference;
+        } else if (use.isResolve()) {
+            resolves.push_back({use.resolveSource, reference});
+        } else {
+            colorReferences.push_back(reference);
+            colorResources.push_back(use.resource);
+        }
+        descriptions.push_back(description);
+        pass.attachments.push_back(use.resource);
+        pass.clearValues.push_back(use.clear.value_or(vk::ClearValue{}));
+    }
+    // One resolve reference per color attachment, unused for the ones that are not resolved
+    std::vector<vk::AttachmentReference> resolveReferences;
+    if (!resolves.empty()) {
+        for (ResourceId color : colorResources) {
+            vk::AttachmentReference reference(VK_ATTACHMENT_UNUSED, vk::ImageLayout::eUndefined);
+            for (const auto& [source, target] : resolves) {
+                if (source == color) {
+                    reference = target;
+                }
+            }
+            resolveReferences.push_back(reference);
+        }
+    }
+
+    vk::SubpassDescription subpass{};
+    subpass.setPipelineBindPoint(vk::PipelineBindPoint::eGraphics)
+        .setColorAttachmentCount(static_cast<uint32_t>(colorReferences.size()))
+        .setPColorAttachments(colorReferences.data())
+        .setPResolveAttachments(resolveReferences.empty() ? nullptr : resolveReferences.data())
+        .setPDepthStencilAttachment(depthReference ? &*depthReference : nullptr);
+    vk::RenderPassCreateInfo createInfo{};
+    createInfo.setAttachmentCount(static_cast<uint32_t>(descriptions.size()))
+        .setPAttachments(descriptions.data())
+        .setSubpassCount(1)
+        .setPSubpasses(&subpass);
+    pass.renderPass = device.createRenderPass(createInfo);
+    pass.compatibilityKey = renderPassCompatibilityKey(createInfo);
+}
+
+void RenderGraph::destroy() {
+    for (auto& pass : passes) {
+        if (pass.renderPass) {
+            device.destroyRenderPass(pass.renderPass);
+        }
+    }
+    passes.clear();
+    resources.clear();
+    finalBarriers.clear();
+    backbuffer = UINT32_MAX;
+}
+
+RenderGraph::Attachments RenderGraph::createAttachments(vk::Extent2D extent, const std::vector<vk::Image>& backbufferImages,
+                                                        const std::vector<vk::ImageView>& backbufferViews) {
+    Attachments attachments{};
+    attachments.extent = extent;
+    attachments.backbufferImages = backbufferImages;
+    attachments.images.resize(resources.size());
+    attachments.views.resize(resources.size());
+    attachments.aliasSources.resize(resources.size());
+
+    struct Placement {
+        ResourceId resource;
+        vk::MemoryRequirements requirements;
+        bool lazy;
+    };
+    std::vector<Placement> placements;
+    for (ResourceId id = 0; id < resources.size(); id++) {
+        const Resource& resource = resources[id];
+        if (resource.imported || resource.firstPass < 0) {
+            continue;
+        }
+        // Contents that never leave their pass can live in lazily allocated memory
+        bool lazy = !(resource.usage & vk::ImageUsageFlagBits::eSampled) && resource.firstPass == resource.lastPass;
+        vk::Extent2D size = scaleExtent(extent, resource.scale);
+        vk::ImageCreateInfo imageInfo{};
+        imageInfo.setImageType(vk::ImageType::e2D)
+            .setFormat(resource.format)
+            .setExtent({size.width, size.height, 1})
+            .setMipLevels(1)
+            .setArrayLayers(1)
+            .setSamples(resource.samples)
+            .setTiling(vk::ImageTiling::eOptimal)
+            .setUsage(lazy ? resource.usage | vk::ImageUsageFlagBits::eTransientAttachment : resource.usage)
+            .setSharingMode(vk::SharingMode::eExclusive)
+            .setInitialLayout(vk::ImageLayout::eUndefined);
+        attachments.images[id] = device.createImage(imageInfo);
+        placements.push_back({id, device.getImageMemoryRequirements(attachments.images[id]), lazy});
+        attachments.imageBytes += placements.back().requirements.size;
+    }
+
+    // Largest first, every image goes into the first slot whose occupants are all dead before it starts or
+    // only born after it ends
+    std::stable_sort(placements.begin(), placements.end(),
+                     [](const Placement& a, const Placement& b) { return a.requirements.size > b.requirements.size; });
+    struct Slot {
+        vk::MemoryRequirements requirements;
+        bool lazy;
+        std::vector<ResourceId> occupants;
+    };
+    std::vector<Slot> slots;
+    for (const auto& placement : placements) {
+        const Resource& resource = resources[placement.resource];
+        auto fits = [&](const Slot& slot) {
+            if (slot.lazy != placement.lazy || !(slot.requirements.memoryTypeBits & placement.requirements.memoryTypeBits)) {
+                return false;
+            }
+            for (ResourceId occupant : slot.occupants) {
+                const Resource& other = resources[occupant];
+                if (other.firstPass <= resource.lastPass && resource.firstPass <= other.lastPass) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        auto slot = std::find_if(slots.begin(), slots.end(), fits);
+        if (slot == slots.end()) {
+            slots.push_back({placement.requirements, placement.lazy, {placement.resource}});
+            continue;
+        }
+        slot->requirements.size = std::max(slot->requirements.size, placement.requirements.size);
+        slot->requirements.alignment = std::max(slot->requirements.alignment, placement.requirements.alignment);
+        slot->requirements.memoryTypeBits &= placement.requirements.memoryTypeBits;
+        slot->occupants.push_back(placement.resource);
+    }
+
+    for (auto& slot : slots) {
+        Allocation allocation = allocator->allocate(slot.requirements, slot.lazy ? MemoryUsage::Transient : MemoryUsage::GpuOnly,
+                                                    ResourceKind::Optimal);
+        std::sort(slot.occupants.begin(), slot.occupants.end(),
+                  [&](ResourceId a, ResourceId b) { return resources[a].firstPass < resources[b].firstPass; });
+        for (size_t i = 0; i < slot.occupants.size(); i++) {
+            ResourceId occupant = slot.occupants[i];
+            device.bindImageMemory(attachments.images[occupant], allocation.memory, allocation.offset);
+            // Each image waits for the one before it in the slot, the first one for the last one of the previous frame
+            const State& previous = resources[slot.occupants[(i + slot.occupants.size() - 1) % slot.occupants.size()]].final;
+            attachments.aliasSources[occupant] = {previous.stages, previous.access};
+        }
+        attachments.boundBytes += slot.requirements.size;
+        attachments.memory.push_back(allocation);
+    }
+
+    for (ResourceId id = 0; id < resources.size(); id++) {
+        if (!attachments.images[id]) {
+            continue;
+        }
+        vk::ImageViewCreateInfo viewInfo{};
+        viewInfo.setImage(attachments.images[id])
+            .setViewType(vk::ImageViewType::e2D)
+            .setFormat(resources[id].format)
+            .setSubresourceRange({aspectFor(resources[id].format), 0, 1, 0, 1});
+        attachments.views[id] = device.createImageView(viewInfo);
+    }
+
+    attachments.framebuffers.resize(passes.size());
+    for (PassId index = 0; index < passes.size(); index++) {
+        const Pass& pass = passes[index];
+        if (pass.culled) {
+            continue;
+        }
+        vk::Extent2D size = scaleExtent(extent, pass.scale);
+        size_t count = pass.rendersToBackbuffer ? backbufferViews.size() : 1;
+        for (size_t image = 0; image < count; image++) {
+            std::vector<vk::ImageView> views;
+            for (ResourceId attachment : pass.attachments) {
+                views.push_back(resources[attachment].imported ? backbufferViews[image] : attachments.views[attachment]);
+            }
+            vk::FramebufferCreateInfo framebufferInfo{};
+            framebufferInfo.setRenderPass(pass.renderPass)
+                .setAttachmentCount(static_cast<uint32_t>(views.size()))
+                .setPAttachments(views.data())
+                .setWidth(size.width)
+                .setHeight(size.height)
+                .setLayers(1);
+            attachments.framebuffers[index].push_back(device.createFramebuffer(framebufferInfo));
+        }
+    }
+    return attachments;
+}
+
+void RenderGraph::destroyAttachments(Attachments& attachments) {
+    for (auto& framebuffers : attachments.framebuffers) {
+        for (auto framebuffer : framebuffers) {
+            device.destroyFramebuffer(framebuffer);
+        }
+    }
+    for (auto view : attachments.views) {
+        if (view) {
+            device.destroyImageView(view);
+        }
+    }
+    for (auto image : attachments.images) {
+        if (image) {
+            device.destroyImage(image);
+        }
+    }
+    for (auto& allocation : attachments.memory) {
+        allocator->free(allocation);
+    }
+    attachments = {};
+}
+
+vk::Framebuffer RenderGraph::framebuffer(const Attachments& attachments, PassId pass, uint32_t imageIndex) const {
+    const auto& framebuffers = attachments.framebuffers[pass];
+    return framebuffers[passes[pass].rendersToBackbuffer ? imageIndex : 0];
+}
+
+void RenderGraph::execute(vk::CommandBuffer commandBuffer, const Attachments& attachments, uint32_t imageIndex, uint32_t frameSlot) const {
+    for (PassId index = 0; index < passes.size(); index++) {
+        const Pass& pass = passes[index];
+        if (pass.culled) {
+            continue;
+        }
+        recordBarriers(commandBuffer, pass.barriers, attachments, imageIndex);
+        PassContext context{pass.renderPass, framebuffer(attachments, index, imageIndex),
+                            scaleExtent(attachments.extent, pass.scale), frameSlot};
+        vk::RenderPassBeginInfo beginInfo{};
+        beginInfo.setRenderPass(context.renderPass)
+            .setFramebuffer(context.framebuffer)
+            .setRenderArea({{0, 0}, context.extent})
+            .setClearValueCount(static_cast<uint32_t>(pass.clearValues.size()))
+            .setPClearValues(pass.clearValues.data()); // clear values for AttachmentLoadOp::eClear
+        uint32_t scope = profiler->beginGpuScope(commandBuffer, pass.name);
+        commandBuffer.beginRenderPass(beginInfo, pass.contents);
+        pass.record(commandBuffer, context);
+        commandBuffer.endRenderPass();
+        profiler->endGpuScope(commandBuffer, scope);
+    }
+    recordBarriers(commandBuffer, finalBarriers, attachments, imageIndex);
+}
+
+// All barriers in front of a pass go into a single vkCmdPipelineBarrier
+void RenderGraph::recordBarriers(vk::CommandBuffer commandBuffer, const std::vector<Barrier>& barriers,
+                                 const Attachments& attachments, uint32_t imageIndex) const {
+    if (barriers.empty()) {
+        return;
+    }
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    vk::PipelineStageFlags srcStages;
+    vk::PipelineStageFlags dstStages;
+    for (const auto& barrier : barriers) {
+        const Resource& resource = resources[barrier.resource];
+        State before = barrier.before;
+        if (barrier.firstUse) {
+            before.stages = attachments.aliasSources[barrier.resource].first;
+            before.access = attachments.aliasSources[barrier.resource].second;
+        }
+        vk::ImageMemoryBarrier imageBarrier{};
+        imageBarrier.setSrcAccessMask(before.access)
+            .setDstAccessMask(barrier.after.access)
+            .setOldLayout(before.layout)
+            .setNewLayout(barrier.after.layout)
+            .setSrcQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setDstQueueFamilyIndex(VK_QUEUE_FAMILY_IGNORED)
+            .setImage(resource.imported ? attachments.backbufferImages[imageIndex] : attachments.images[barrier.resource])
+            .setSubresourceRange({aspectFor(resource.format), 0, 1, 0, 1});
+        imageBarriers.push_back(imageBarrier);
+        srcStages |= before.stages;
+        dstStages |= barrier.after.stages;
+    }
+    commandBuffer.pipelineBarrier(srcStages ? srcStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe),
+                                  dstStages, {}, 0, nullptr, 0, nullptr,
+                                  static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+RenderGraph::Stats RenderGraph::stats() const {
+    Stats stats{};
+    for (const auto& pass : passes) {
+        stats.passes++;
+        stats.culledPasses += pass.culled ? 1 : 0;
+        stats.barriers += static_cast<uint32_t>(pass.barriers.size());
+    }
+    stats.barriers += static_cast<uint32_t>(finalBarriers.size());
+    for (const auto& resource : resources) {
+        stats.transientImages += !resource.imported && resource.firstPass >= 0 ? 1 : 0;
+    }
+    return stats;
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include "vulkan_common.hpp"
+#include "memory_allocator.hpp"
+#include "profiler.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+// Frame graph: passes declare the images they write as attachments and the images they sample, compile()
+// derives the rest. Passes run in the order they were added, minus the ones nothing reaching the backbuffer
+// depends on. Every pass gets its own render pass with load and store operations matching how its attachments
+// are used before and after it, and the pipeline barriers and layout transitions between passes are recorded
+// by execute(). Transient images whose lifetimes do not overlap share the same memory.
+//
+// The graph only depends on formats and is compiled once per surface format. Everything that depends on the
+// extent or on the swapchain images lives in Attachments, created and retired along with the swapchain.
+class RenderGraph {
+public:
+    using ResourceId = uint32_t;
+    using PassId = uint32_t;
+
+    struct PassContext {
+        vk::RenderPass renderPass;
+        vk::Framebuffer framebuffer;
+        vk::Extent2D extent;
+        uint32_t frameSlot;
+    };
+    // Records the body of the pass, between its beginRenderPass and endRenderPass
+    using RecordFunction = std::function<void(vk::CommandBuffer commandBuffer, const PassContext& context)>;
+
+    // Everything created for one backbuffer extent
+    struct Attachments {
+        vk::Extent2D extent;
+        std::vector<vk::Image> backbufferImages;
+        std::vector<vk::Image> images;    // per resource, null for the backbuffer and unused images
+        std::vector<vk::ImageView> views; // per resource, null for the backbuffer and unused images
+        std::vector<Allocation> memory;   // per aliasing slot
+        // Per pass: one framebuffer per backbuffer image when the pass renders to the backbuffer, one otherwise
+        std::vector<std::vector<vk::Framebuffer>> framebuffers;
+        // Per resource: what last touched its memory, the first barrier of the frame waits for it
+        std::vector<std::pair<vk::PipelineStageFlags, vk::AccessFlags>> aliasSources;
+        vk::DeviceSize boundBytes = 0;    // memory actually allocated for transient images
+        vk::DeviceSize imageBytes = 0;    // what one allocation per transient image would take
+    };
+
+    struct Stats {
+        uint32_t passes = 0;
+        uint32_t culledPasses = 0;
+        uint32_t transientImages = 0;
+        uint32_t barriers = 0; // image barriers recorded per frame
+    };
+
+    void init(vk::Device device, DeviceAllocator& allocator, Profiler& profiler);
+
+    // The backbuffer is the output of the graph, passes only survive culling if they contribute to it.
+    // It is left in finalLayout at the end of the frame.
+    ResourceId importBackbuffer(const char* name, vk::Format format, vk::ImageLayout finalLayout);
+    // Transient image, scale is relative to the backbuffer extent
+    ResourceId createImage(const char* name, vk::Format format, float scale = 1.0f,
+                           vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1);
+    // Pass names must be string literals, they end up in the profiler
+    PassId addPass(const char* name, RecordFunction record, vk::SubpassContents contents = vk::SubpassContents::eInline);
+    // Color or depth attachment depending on the format. A clear value discards the previous contents.
+    void write(PassId pass, ResourceId resource, std::optional<vk::ClearValue> clear = std::nullopt);
+    // Sampled by the fragment shader
+    void read(PassId pass, ResourceId resource);
+    // Resolves a multisampled color attachment the pass writes into a single-sampled image at the end of the
+    // subpass. The target is overwritten as a whole, its previous contents are discarded.
+    void resolve(PassId pass, ResourceId source, ResourceId target);
+
+    void compile();
+    // Forgets every pass and resource. Attachments are independent of it and can be destroyed later.
+    void destroy();
+
+    Attachments createAttachments(vk::Extent2D extent, const std::vector<vk::Image>& backbufferImages,
+                                  const std::vector<vk::ImageView>& backbufferViews);
+    void destroyAttachments(Attachments& attachments);
+
+    // Records every pass that survived culling, outside of any render pass
+    void execute(vk::CommandBuffer commandBuffer, const Attachments& attachments, uint32_t imageIndex, uint32_t frameSlot) const;
+
+    vk::RenderPass renderPass(PassId pass) const { return passes[pass].renderPass; }
+    uint64_t compatibilityKey(PassId pass) const { return passes[pass].compatibilityKey; }
+    vk::Framebuffer framebuffer(const Attachments& attachments, PassId pass, uint32_t imageIndex) const;
+    vk::ImageView view(const Attachments& attachments, ResourceId resource) const { return attachments.views[resource]; }
+    Stats stats() const;
+
+private:
+    enum class Access { ColorAttachment, DepthAttachment, Sampled };
+
+    struct State {
+        vk::ImageLayout layout = vk::ImageLayout::eUndefined;
+        vk::PipelineStageFlags stages;
+        vk::AccessFlags access;
+    };
+    struct Use {
+        ResourceId resource;
+        Access access;
+        std::optional<vk::ClearValue> clear;
+        ResourceId resolveSource = UINT32_MAX; // set on the resolve target of a multisampled attachment
+
+        bool isResolve() const { return resolveSource != UINT32_MAX; }
+        // Written without looking at what was there before
+        bool discards() const { return clear.has_value() || isResolve(); }
+    };
+    struct Barrier {
+        ResourceId resource;
+        State before;
+        State after;
+        bool firstUse = false; // waits on Attachments::aliasSources instead of before
+    };
+    struct Resource {
+        const char* name;
+        vk::Format format;
+        float scale = 1.0f;
+        vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+        bool imported = false;
+        State final;           // imported: what the frame leaves behind, transient: the state after the last use
+        vk::ImageUsageFlags usage;
+        int32_t firstPass = -1; // lifetime in pass indices, -1 when no surviving pass uses it
+        int32_t lastPass = -1;
+    };
+    struct Pass {
+        const char* name;
+        RecordFunction record;
+        vk::SubpassContents contents;
+        std::vector<Use> uses;
+        bool culled = false;
+        bool rendersToBackbuffer = false;
+        float scale = 1.0f;
+        vk::RenderPass renderPass;
+        uint64_t compatibilityKey = 0;
+        std::vector<ResourceId> attachments; // framebuffer order
+        std::vector<vk::ClearValue> clearValues;
+        std::vector<Barrier> barriers;       // recorded before the render pass begins
+    };
+
+    static State stateFor(Access access);
+    void cull();
+    void createRenderPass(PassId index);
+    void recordBarriers(vk::CommandBuffer commandBuffer, const std::vector<Barrier>& barriers,
+                        const Attachments& attachments, uint32_t imageIndex) const;
+
+    vk::Device device;
+    DeviceAllocator* allocator = nullptr;
+    Profiler* profiler = nullptr;
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<Barrier> finalBarriers; // recorded after the last pass
+    ResourceId backbuffer = UINT32_MAX;
+};
@@ -0,0 +1,225 @@
+#include "scene.hpp"
+#include "camera.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+constexpr float k_spacing = 2.5f;
+}
+
+void InstancedScene::createSetLayout(vk::Device device) {
+    this->device = device;
+    vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eCompute | vk::ShaderStageFlagBits::eVertex;
+    vk::DescriptorSetLayoutBinding bindings[] = {
+        {0, vk::DescriptorType::eStorageBuffer, 1, stages},                          // instances
+        {1, vk::DescriptorType::eStorageBuffer, 1, stages},                          // visible instance indices
+        {2, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eCompute}, // draw commands
+    };
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.setBindingCount(3)
+        .setPBindings(bindings);
+    descriptorSetLayout = device.createDescriptorSetLayout(layoutInfo);
+}
+
+std::vector<vk::VertexInputBindingDescription> InstancedScene::vertexBindings() {
+    return {vk::VertexInputBindingDescription(0, sizeof(Vertex), vk::VertexInputRate::eVertex)};
+}
+
+std::vector<vk::VertexInputAttributeDescription> InstancedScene::vertexAttributes() {
+    return {
+        vk::VertexInputAttributeDescription(0, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, position)),
+        vk::VertexInputAttributeDescription(1, 0, vk::Format::eR32G32B32Sfloat, offsetof(Vertex, color)),
+    };
+}
+
+void InstancedScene::init(DeviceAllocator& allocator, UploadManager& uploads, uint32_t instanceCount, bool multiDraw,
+                          vk::ShaderModule cullShader, vk::PipelineCache pipelineCache) {
+    this->allocator = &allocator;
+    this->uploads = &uploads;
+    this->multiDraw = multiDraw;
+    instances = instanceCount;
+    ready = false;
+
+    // A unit cube and a square pyramid, both counter-clockwise seen from outside and inside a sphere of radius sqrt(3)/2
+    std::vector<Vertex> vertices;
+    for (int i = 0; i < 8; i++) {
+        float x = float(i & 1), y = float((i >> 1) & 1), z = float((i >> 2) & 1);
+        vertices.push_back({{x - 0.5f, y - 0.5f, z - 0.5f}, {0.3f + 0.7f * x, 0.3f + 0.7f * y, 0.3f + 0.7f * z}});
+    }
+    vertices.push_back({{-0.5f, -0.5f, -0.5f}, {0.2f, 0.2f, 0.8f}});
+    vertices.push_back({{0.5f, -0.5f, -0.5f}, {0.2f, 0.8f, 0.2f}});
+    vertices.push_back({{0.5f, -0.5f, 0.5f}, {0.8f, 0.2f, 0.2f}});
+    vertices.push_back({{-0.5f, -0.5f, 0.5f}, {0.8f, 0.8f, 0.2f}});
+    vertices.push_back({{0.0f, 0.5f, 0.0f}, {1.0f, 1.0f, 1.0f}});
+    std::vector<uint16_t> indices = {
+        0, 4, 6, 0, 6, 2, 5, 1, 3, 5, 3, 7, 0, 1, 5, 0, 5, 4, 3, 2, 6, 3, 6, 7, 1, 0, 2, 1, 2, 3, 4, 5, 7, 4, 7, 6,
+        0, 1, 2, 0, 2, 3, 0, 4, 1, 1, 4, 2, 2, 4, 3, 3, 4, 0,
+    };
+    struct MeshRange { uint32_t indexCount, firstIndex; int32_t vertexOffset; };
+    const MeshRange meshes[] = {{36, 0, 0}, {18, 36, 8}};
+    constexpr uint32_t meshCount = 2;
+    static_assert(meshCount <= k_maxMeshes);
+    cullConstants.boundingRadius = 0.87f;
+
+    // Instances on a square grid, jittered a little; mesh i % meshCount so every mesh gets an equal share
+    std::vector<Instance> instanceData(instanceCount);
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(double(std::max(instanceCount, 1u)))));
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::vector<uint32_t> meshInstances(meshCount, 0);
+    for (uint32_t i = 0; i < instanceCount; i++) {
+        Instance& instance = instanceData[i];
+        instance.position[0] = (float(i % side) - side / 2.0f + unit(random) * 0.5f) * k_spacing;
+        instance.position[1] = unit(random) * 2.0f;
+        instance.position[2] = (float(i / side) - side / 2.0f + unit(random) * 0.5f) * k_spacing;
+        instance.scale = 0.5f + unit(random) * 0.7f;
+        for (float& channel : instance.color) {
+            channel = 0.4f + unit(random) * 0.6f;
+        }
+        instance.mesh = i % meshCount;
+        meshInstances[instance.mesh]++;
+    }
+    // Every mesh owns a range of the visible list as large as its instance count. With a single multi-draw
+    // the vertex shader finds the range through firstInstance, otherwise through the pushed offset.
+    uint32_t firstVisible = 0;
+    initialCommands.clear();
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++) {
+        cullConstants.meshFirstVisible[mesh] = firstVisible;
+        initialCommands.emplace_back(meshes[mesh].indexCount, 0, meshes[mesh].firstIndex, meshes[mesh].vertexOffset,
+                                     multiDraw ? firstVisible : 0);
+        firstVisible += meshInstances[mesh];
+    }
+    cullConstants.instanceCount = instanceCount;
+
+    auto createBuffer = [&](vk::DeviceSize size, vk::BufferUsageFlags usage, Allocation& allocation) {
+        vk::BufferCreateInfo bufferInfo{};
+        bufferInfo.setSize(std::max<vk::DeviceSize>(size, 4))
+            .setUsage(usage)
+            .setSharingMode(vk::SharingMode::eExclusive);
+        return allocator.createBuffer(bufferInfo, MemoryUsage::GpuOnly, allocation);
+    };
+    using Usage = vk::BufferUsageFlagBits;
+    vertexBuffer = createBuffer(vertices.size() * sizeof(Vertex), Usage::eVertexBuffer | Usage::eTransferDst, vertexAllocation);
+    indexBuffer = createBuffer(indices.size() * sizeof(uint16_t), Usage::eIndexBuffer | Usage::eTransferDst, indexAllocation);
+    instanceBuffer = createBuffer(instanceData.size() * sizeof(Instance), Usage::eStorageBuffer | Usage::eTransferDst, instanceAllocation);
+    visibleBuffer = createBuffer(vk::DeviceSize(instanceCount) * sizeof(uint32_t), Usage::eStorageBuffer, visibleAllocation);
+    drawCommandBuffer = createBuffer(initialCommands.size() * sizeof(vk::DrawIndexedIndirectCommand),
+                                     Usage::eIndirectBuffer | Usage::eStorageBuffer | Usage::eTransferDst, drawCommandAllocation);
+
+    uploads.uploadBuffer(vertexBuffer, 0, vertices.data(), vertices.size() * sizeof(Vertex));
+    uploads.uploadBuffer(indexBuffer, 0, indices.data(), indices.size() * sizeof(uint16_t));
+    uploads.uploadBuffer(instanceBuffer, 0, instanceData.data(), instanceData.size() * sizeof(Instance));
+    uploadTicket = uploads.flush();
+
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eStorageBuffer, 3);
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.setMaxSets(1)
+        .setPoolSizeCount(1)
+        .setPPoolSizes(&poolSize);
+    descriptorPool = device.createDescriptorPool(poolInfo);
+    vk::DescriptorSetAllocateInfo allocInfo{};
+    allocInfo.setDescriptorPool(descriptorPool)
+        .setDescriptorSetCount(1)
+        .setPSetLayouts(&descriptorSetLayout);
+    descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
+    vk::DescriptorBufferInfo bufferInfos[] = {
+        {instanceBuffer, 0, VK_WHOLE_SIZE},
+        {visibleBuffer, 0, VK_WHOLE_SIZE},
+        {drawCommandBuffer, 0, VK_WHOLE_SIZE},
+    };
+    vk::WriteDescriptorSet write{};
+    write.setDstSet(descriptorSet)
+        .setDstBinding(0)
+        .setDescriptorCount(3)
+        .setDescriptorType(vk::DescriptorType::eStorageBuffer)
+        .setPBufferInfo(bufferInfos);
+    device.updateDescriptorSets(1, &write, 0, nullptr);
+
+    cullPipeline.create(device, cullShader, {descriptorSetLayout}, sizeof(CullConstants), pipelineCache);
+}
+
+void InstancedScene::destroy() {
+    if (!allocator) {
+        if (descriptorSetLayout) {
+            device.destroyDescriptorSetLayout(descriptorSetLayout);
+            descriptorSetLayout = nullptr;
+        }
+        return;
+    }
+    cullPipeline.destroy();
+    device.destroyDescriptorPool(descriptorPool);
+    device.destroyDescriptorSetLayout(descriptorSetLayout);
+    descriptorSetLayout = nullptr;
+    allocator->destroyBuffer(vertexBuffer, vertexAllocation);
+    allocator->destroyBuffer(indexBuffer, indexAllocation);
+    allocator->destroyBuffer(instanceBuffer, instanceAllocation);
+    allocator->destroyBuffer(visibleBuffer, visibleAllocation);
+    allocator->destroyBuffer(drawCommandBuffer, drawCommandAllocation);
+    allocator = nullptr;
+}
+
+void InstancedScene::update(uint64_t frame, float aspect) {
+    // Orbit over the field, low enough that a large part of it is behind or beside the camera
+    float fieldSize = std::sqrt(float(std::max(instances, 1u))) * k_spacing;
+    float radius = std::max(fieldSize * 0.35f, 8.0f);
+    float angle = float(frame % 3600) / 3600.0f * 6.2831853f;
+    float eye[3] = {radius * std::cos(angle), radius * 0.3f, radius * std::sin(angle)};
+    float center[3] = {0.0f, 0.0f, 0.0f};
+    float view[16], projection[16];
+    lookAt(eye, center, view);
+    perspective(1.0472f, aspect, 0.1f, fieldSize * 2.0f + radius, projection);
+    multiply(projection, view, viewProjection);
+    frustumPlanes(viewProjection, cullConstants.planes);
+}
+
+bool InstancedScene::recordCull(vk::CommandBuffer commandBuffer) {
+    if (!ready) {
+        ready = uploads->isReady(uploadTicket);
+        if (!ready) {
+            return false;
+        }
+    }
+    // The previous frame's draws read the visible list and the draw commands rewritten below
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+                                  vk::PipelineStageFlagBits::eTransfer | vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, 0, nullptr, 0, nullptr, 0, nullptr);
+    commandBuffer.updateBuffer(drawCommandBuffer, 0, initialCommands.size() * sizeof(vk::DrawIndexedIndirectCommand), initialCommands.data());
+    vk::MemoryBarrier resetBarrier(vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+                                  {}, 1, &resetBarrier, 0, nullptr, 0, nullptr);
+
+    cullPipeline.bind(commandBuffer, descriptorSet);
+    cullPipeline.pushConstants(commandBuffer, &cullConstants, sizeof(cullConstants));
+    commandBuffer.dispatch(ComputePipeline::groupCount(instances, 64), 1, 1);
+
+    vk::MemoryBarrier cullBarrier(vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eShaderRead);
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexShader,
+                                  {}, 1, &cullBarrier, 0, nullptr, 0, nullptr);
+    return true;
+}
+
+void InstancedScene::recordDraw(vk::CommandBuffer commandBuffer, vk::Pipeline pipeline, vk::PipelineLayout pipelineLayout) const {
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    vk::DeviceSize offset = 0;
+    commandBuffer.bindVertexBuffers(0, 1, &vertexBuffer, &offset);
+    commandBuffer.bindIndexBuffer(indexBuffer, 0, vk::IndexType::eUint16);
+    commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, 0, sizeof(viewProjection), viewProjection);
+    // One command per mesh, whatever the instance count
+    uint32_t meshCount = static_cast<uint32_t>(initialCommands.size());
+    if (multiDraw) {
+        uint32_t firstVisible = 0;
+        commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, sizeof(viewProjection), sizeof(uint32_t), &firstVisible);
+        commandBuffer.drawIndexedIndirect(drawCommandBuffer, 0, meshCount, sizeof(vk::DrawIndexedIndirectCommand));
+        return;
+    }
+    for (uint32_t mesh = 0; mesh < meshCount; mesh++) {
+        commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eVertex, sizeof(viewProjection), sizeof(uint32_t),
+                                    &cullConstants.meshFirstVisible[mesh]);
+        commandBuffer.drawIndexedIndirect(drawCommandBuffer, mesh * sizeof(vk::DrawIndexedIndirectCommand), 1,
+                                          sizeof(vk::DrawIndexedIndirectCommand));
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include "vulkan_common.hpp"
+#include "memory_allocator.hpp"
+#include "upload_manager.hpp"
+#include "compute.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// Benchmark scene for GPU-driven rendering: instances of a few built-in meshes scattered over a square field.
+// A compute pass frustum-culls every instance against the camera and compacts the survivors into one
+// VkDrawIndexedIndirectCommand per mesh, so the CPU records the same handful of commands for any instance count.
+class InstancedScene {
+public:
+    // Vertex shader push constants: the camera's view-projection matrix and the mesh's start in the visible list
+    static constexpr uint32_t k_pushConstantSize = sizeof(float) * 16 + sizeof(uint32_t);
+    static constexpr uint32_t k_maxMeshes = 4;
+
+    // The set layout is needed by the draw pipeline before the scene data exists
+    void createSetLayout(vk::Device device);
+    // multiDraw: the device supports multiDrawIndirect and drawIndirectFirstInstance, so all meshes go
+    // out in a single indirect draw. Otherwise each mesh is drawn on its own with its visible list offset pushed.
+    void init(DeviceAllocator& allocator, UploadManager& uploads, uint32_t instanceCount, bool multiDraw,
+              vk::ShaderModule cullShader, vk::PipelineCache pipelineCache);
+    void destroy();
+
+    vk::DescriptorSetLayout setLayout() const { return descriptorSetLayout; }
+    static std::vector<vk::VertexInputBindingDescription> vertexBindings();
+    static std::vector<vk::VertexInputAttributeDescription> vertexAttributes();
+    uint32_t instanceCount() const { return instances; }
+
+    // Places the camera for the given frame, derived from the frame number so headless runs are repeatable
+    void update(uint64_t frame, float aspect);
+    // Outside of a render pass: resets the draw commands and culls into them.
+    // Returns false (and records nothing) until the scene's uploads have been acquired.
+    bool recordCull(vk::CommandBuffer commandBuffer);
+    // Inside the render pass, after a successful recordCull()
+    void recordDraw(vk::CommandBuffer commandBuffer, vk::Pipeline pipeline, vk::PipelineLayout pipelineLayout) const;
+
+private:
+    struct Vertex {
+        float position[3];
+        float color[3];
+    };
+    // Mirrors the std430 layout in cull.comp and instanced.vert
+    struct Instance {
+        float position[3];
+        float scale;
+        float color[3];
+        uint32_t mesh;
+    };
+    struct CullConstants {
+        float planes[6][4];
+        uint32_t instanceCount;
+        float boundingRadius;
+        uint32_t meshFirstVisible[k_maxMeshes];
+    };
+
+    vk::Device device;
+    DeviceAllocator* allocator = nullptr;
+    UploadManager* uploads = nullptr;
+    uint32_t instances = 0;
+    UploadTicket uploadTicket = 0;
+    bool ready = false;
+    bool multiDraw = false;
+
+    // Initial state of the per-mesh draw commands, restored before every cull
+    std::vector<vk::DrawIndexedIndirectCommand> initialCommands;
+    float viewProjection[16] = {};
+    CullConstants cullConstants{};
+
+    vk::Buffer vertexBuffer, indexBuffer, instanceBuffer, visibleBuffer, drawCommandBuffer;
+    Allocation vertexAllocation, indexAllocation, instanceAllocation, visibleAllocation, drawCommandAllocation;
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::DescriptorPool descriptorPool;
+    vk::DescriptorSet descriptorSet;
+    ComputePipeline cullPipeline;
+};
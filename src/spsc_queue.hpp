@@ -0,0 +1,46 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread. Each side only writes
+// its own index, so push() and pop() are a handful of loads and stores without any read-modify-write.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // Producer only. Returns false when the queue is full.
+    bool push(const T& value) {
+        size_t head = writeIndex.load(std::memory_order_relaxed);
+        if (head - readIndex.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        slots[head & (Capacity - 1)] = value;
+        writeIndex.store(head + 1, std::memory_order_release); // publishes the slot
+        return true;
+    }
+
+    // Consumer only. Returns false when the queue is empty.
+    bool pop(T& value) {
+        size_t tail = readIndex.load(std::memory_order_relaxed);
+        if (tail == writeIndex.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = slots[tail & (Capacity - 1)];
+        readIndex.store(tail + 1, std::memory_order_release); // hands the slot back to the producer
+        return true;
+    }
+
+    // Either side, a snapshot that may be outdated as soon as it returns
+    bool empty() const {
+        return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    // On separate cache lines, so the two threads do not invalidate each other's index on every operation
+    alignas(64) std::atomic<size_t> writeIndex{0};
+    alignas(64) std::atomic<size_t> readIndex{0};
+    std::array<T, Capacity> slots{};
+};
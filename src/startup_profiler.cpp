@@ -0,0 +1,65 @@
+#include "startup_profiler.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+void StartupProfiler::begin() {
+    std::lock_guard<std::mutex> lock(mutex);
+    startTime = clock::now();
+    endTime = startTime;
+    phases.clear();
+    threads = {{std::this_thread::get_id(), 0}};
+}
+
+void StartupProfiler::finish() {
+    std::lock_guard<std::mutex> lock(mutex);
+    endTime = clock::now();
+}
+
+void StartupProfiler::record(const char* name, clock::time_point start, clock::time_point end) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto thread = threads.try_emplace(std::this_thread::get_id(), static_cast<uint32_t>(threads.size())).first->second;
+    phases.push_back({name, thread, start, end});
+}
+
+double StartupProfiler::totalMs() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return milliseconds(endTime - startTime);
+}
+
+void StartupProfiler::printSummary(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    double summed = 0.0;
+    const Phase* slowest = nullptr;
+    for (const auto& phase : phases) {
+        summed += milliseconds(phase.end - phase.start);
+        if (!slowest || phase.end - phase.start > slowest->end - slowest->start) {
+            slowest = &phase;
+        }
+    }
+    out << "Startup: " << milliseconds(endTime - startTime) << " ms, " << summed << " ms of phases on " << threads.size() << " thread(s)";
+    if (slowest) {
+        out << ", slowest " << slowest->name << " (" << milliseconds(slowest->end - slowest->start) << " ms)";
+    }
+    out << std::endl;
+}
+
+void StartupProfiler::writeJson(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("failed to open " + path + " for writing!");
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Phase> sorted = phases;
+    std::stable_sort(sorted.begin(), sorted.end(), [](const Phase& a, const Phase& b) { return a.start < b.start; });
+
+    file << "{\n\"totalMs\":" << milliseconds(endTime - startTime) << ",\n\"threads\":" << threads.size() << ",\n\"phases\":[";
+    for (size_t i = 0; i < sorted.size(); i++) {
+        const Phase& phase = sorted[i];
+        file << (i == 0 ? "\n" : ",\n") << "{\"name\":\"" << phase.name << "\",\"thread\":" << phase.thread
+             << ",\"startMs\":" << milliseconds(phase.start - startTime)
+             << ",\"durationMs\":" << milliseconds(phase.end - phase.start) << "}";
+    }
+    file << "\n]}\n";
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Wall-clock phases of application startup, from the first line of run() to the first frame. Phases may
+// run on several threads at once, the report keeps the thread of each so overlapping work shows up next to
+// the critical path. Written as JSON for release-to-release comparisons (--startup-report).
+class StartupProfiler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    class Scope {
+    public:
+        Scope(StartupProfiler& profiler, const char* name) : profiler(profiler), name(name), start(clock::now()) {}
+        ~Scope() { profiler.record(name, start, clock::now()); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StartupProfiler& profiler;
+        const char* name;
+        clock::time_point start;
+    };
+
+    // Startup begins here, the constructing thread is reported as thread 0
+    void begin();
+    // Thread-safe. Phase names must be string literals.
+    template <typename Function>
+    decltype(auto) measure(const char* name, Function&& function) {
+        Scope scope(*this, name);
+        return function();
+    }
+    void finish();
+
+    double totalMs() const;
+    // One line: wall time, the time summed over all phases and the slowest phase
+    void printSummary(std::ostream& out) const;
+    void writeJson(const std::string& path) const;
+
+private:
+    struct Phase {
+        const char* name;
+        uint32_t thread;
+        clock::time_point start;
+        clock::time_point end;
+    };
+
+    void record(const char* name, clock::time_point start, clock::time_point end);
+    static double milliseconds(clock::duration duration) { return std::chrono::duration<double, std::milli>(duration).count(); }
+
+    mutable std::mutex mutex;
+    clock::time_point startTime;
+    clock::time_point endTime;
+    std::vector<Phase> phases;
+    std::map<std::thread::id, uint32_t> threads;
+};
@@ -0,0 +1,98 @@
+#include "thread_pool.hpp"
+
+ThreadPool::ThreadPool(uint32_t workerCount) {
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& function) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || workers.empty()) {
+        for (uint32_t index = 0; index < count; index++) {
+            function(index);
+        }
+        return;
+    }
+    Job current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        job = {&function, count, static_cast<uint32_t>(generation)};
+        current = job;
+        remainingTasks = count;
+        nextTask = uint64_t(job.generation) << 32;
+        firstError = nullptr;
+    }
+    wake.notify_all();
+    runTasks(current);
+
+    // Also waits for the workers to leave runTasks, none of them may still look at this job once it returns
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return remainingTasks == 0 && activeWorkers == 0; });
+    job.task = nullptr;
+    if (firstError) {
+        std::rethrow_exception(firstError);
+    }
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        Job current;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+            current = job;
+            activeWorkers++;
+        }
+        runTasks(current);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWorkers--;
+        }
+        done.notify_all();
+    }
+}
+
+void ThreadPool::runTasks(const Job& job) {
+    const uint64_t tag = uint64_t(job.generation) << 32;
+    uint64_t next = nextTask.load();
+    while ((next & ~0xffffffffull) == tag && static_cast<uint32_t>(next) < job.count) {
+        if (!nextTask.compare_exchange_weak(next, next + 1)) {
+            continue; // next now holds the current value
+        }
+        uint32_t index = static_cast<uint32_t>(next);
+        try {
+            (*job.task)(index);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!firstError) {
+                firstError = std::current_exception();
+            }
+        }
+        if (remainingTasks.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+        next = nextTask.load();
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for fork/join work such as per-frame command recording.
+// The calling thread takes part in every parallelFor, so a pool with 0 workers runs everything inline.
+class ThreadPool {
+public:
+    explicit ThreadPool(uint32_t workerCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Worker threads plus the calling thread
+    uint32_t concurrency() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+    // Calls task(index) for every index in [0, count) and blocks until all of them returned.
+    // Each index runs on exactly one thread, the first exception thrown by a task is rethrown here.
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& task);
+
+private:
+    // What a thread runs for one parallelFor, copied under the mutex
+    struct Job {
+        const std::function<void(uint32_t)>* task = nullptr;
+        uint32_t count = 0;
+        uint32_t generation = 0;
+    };
+
+    void workerLoop();
+    void runTasks(const Job& job);
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    uint64_t generation = 0;
+    bool stopping = false;
+    Job job;
+    uint32_t activeWorkers = 0; // workers inside runTasks
+
+    // Generation in the high 32 bits, next index in the low 32 bits: an index can only be taken together with
+    // the job it belongs to, a worker still holding the previous job never takes one from the next
+    std::atomic<uint64_t> nextTask{0};
+    std::atomic<uint32_t> remainingTasks{0};
+    std::exception_ptr firstError;
+};
@@ -0,0 +1,115 @@
+#include "uniform_ring.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace {
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+}
+
+void UniformRing::createSetLayout(vk::Device device) {
+    this->device = device;
+    vk::DescriptorSetLayoutBinding binding(0, vk::DescriptorType::eUniformBufferDynamic, 1, vk::ShaderStageFlagBits::eAll);
+    vk::DescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.setBindingCount(1)
+        .setPBindings(&binding);
+    descriptorSetLayout = device.createDescriptorSetLayout(layoutInfo);
+}
+
+void UniformRing::init(vk::PhysicalDevice physicalDevice, DeviceAllocator& allocator, uint32_t frameSlots, vk::DeviceSize bytesPerFrame) {
+    this->allocator = &allocator;
+    alignment = std::max<vk::DeviceSize>(physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment, 1);
+    regionSize = alignUp(bytesPerFrame, alignment);
+
+    // The binding always covers k_maxBlockBytes from the dynamic offset, the tail keeps that inside the buffer
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.setSize(regionSize * frameSlots + k_maxBlockBytes)
+        .setUsage(vk::BufferUsageFlagBits::eUniformBuffer)
+        .setSharingMode(vk::SharingMode::eExclusive);
+    buffer = allocator.createBuffer(bufferInfo, MemoryUsage::CpuToGpu, allocation);
+    if (!allocation.mapped) {
+        throw std::runtime_error("uniform ring memory is not host visible!");
+    }
+
+    vk::DescriptorPoolSize poolSize(vk::DescriptorType::eUniformBufferDynamic, 1);
+    vk::DescriptorPoolCreateInfo poolInfo{};
+    poolInfo.setMaxSets(1)
+        .setPoolSizeCount(1)
+        .setPPoolSizes(&poolSize);
+    descriptorPool = device.createDescriptorPool(poolInfo);
+    vk::DescriptorSetAllocateInfo allocInfo{};
+    allocInfo.setDescriptorPool(descriptorPool)
+        .setDescriptorSetCount(1)
+        .setPSetLayouts(&descriptorSetLayout);
+    descriptorSet = device.allocateDescriptorSets(allocInfo)[0];
+    // Written once, every draw only supplies a different dynamic offset
+    vk::DescriptorBufferInfo bufferDescriptor(buffer, 0, k_maxBlockBytes);
+    vk::WriteDescriptorSet write{};
+    write.setDstSet(descriptorSet)
+        .setDstBinding(0)
+        .setDescriptorCount(1)
+        .setDescriptorType(vk::DescriptorType::eUniformBufferDynamic)
+        .setPBufferInfo(&bufferDescriptor);
+    device.updateDescriptorSets(1, &write, 0, nullptr);
+}
+
+void UniformRing::destroy() {
+    if (buffer) {
+        allocator->destroyBuffer(buffer, allocation);
+        buffer = nullptr;
+        device.destroyDescriptorPool(descriptorPool);
+        descriptorPool = nullptr;
+        descriptorSet = nullptr;
+    }
+    if (descriptorSetLayout) {
+        device.destroyDescriptorSetLayout(descriptorSetLayout);
+        descriptorSetLayout = nullptr;
+    }
+}
+
+void UniformRing::describeConstants(uint32_t size, vk::ShaderStageFlags stages, std::vector<vk::DescriptorSetLayout>& setLayouts,
+                                    std::vector<vk::PushConstantRange>& pushConstantRanges) const {
+    if (usesPushConstants(size)) {
+        pushConstantRanges.push_back(vk::PushConstantRange(stages, 0, size));
+    } else {
+        setLayouts.push_back(descriptorSetLayout);
+    }
+}
+
+void UniformRing::beginFrame(uint32_t slot) {
+    regionStart = regionSize * slot;
+    head.store(0, std::memory_order_relaxed);
+}
+
+uint32_t UniformRing::write(const void* data, uint32_t size) {
+    if (size > k_maxBlockBytes) {
+        throw std::runtime_error("constants block of " + std::to_string(size) + " bytes is larger than a uniform binding!");
+    }
+    vk::DeviceSize offset = head.fetch_add(alignUp(size, alignment), std::memory_order_relaxed);
+    if (offset + size > regionSize) {
+        throw std::runtime_error("uniform ring exhausted (" + std::to_string(regionSize) + " bytes per frame)!");
+    }
+    memcpy(static_cast<char*>(allocation.mapped) + regionStart + offset, data, size);
+    return static_cast<uint32_t>(regionStart + offset);
+}
+
+void UniformRing::bindConstants(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, vk::ShaderStageFlags stages,
+                                uint32_t setIndex, const void* data, uint32_t size) {
+    if (usesPushConstants(size)) {
+        commandBuffer.pushConstants(pipelineLayout, stages, 0, size, data);
+        return;
+    }
+    uint32_t dynamicOffset = write(data, size);
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, pipelineLayout, setIndex, 1, &descriptorSet, 1, &dynamicOffset);
+}
+
+void UniformRing::flush() {
+    vk::DeviceSize used = std::min(head.load(std::memory_order_relaxed), regionSize);
+    if (used > 0 && !allocation.coherent) {
+        allocator->flush(allocation, regionStart, used);
+    }
+}
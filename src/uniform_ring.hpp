@@ -0,0 +1,65 @@
+#pragma once
+#include "vulkan_common.hpp"
+#include "memory_allocator.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Per-frame and per-draw constants. One persistently mapped buffer is split into a region per frame slot,
+// draws bump-allocate sub-ranges aligned to minUniformBufferOffsetAlignment and bind them through a single
+// uniform-buffer-dynamic descriptor set with a dynamic offset. The set is written once at init, so a frame
+// neither maps memory nor writes descriptors, and non-coherent memory gets one flush per frame.
+//
+// Blocks of up to k_pushConstantBytes skip the ring and go out as push constants. Which path a block takes
+// only depends on its size, so the pipeline layout (describeConstants) and the shader agree on it up front:
+//   size <= 128: layout(push_constant) uniform Block { ... };
+//   size >  128: layout(set = N, binding = 0) uniform Block { ... };
+class UniformRing {
+public:
+    // The smallest maxPushConstantsSize a device may report
+    static constexpr uint32_t k_pushConstantBytes = 128;
+    // The smallest maxUniformBufferRange a device may report, the largest block the ring binds
+    static constexpr uint32_t k_maxBlockBytes = 16384;
+    static constexpr vk::DeviceSize k_defaultBytesPerFrame = 1ull << 20;
+
+    static constexpr bool usesPushConstants(uint32_t size) { return size <= k_pushConstantBytes; }
+
+    // The set layout is needed by the pipelines before the ring exists
+    void createSetLayout(vk::Device device);
+    void init(vk::PhysicalDevice physicalDevice, DeviceAllocator& allocator, uint32_t frameSlots,
+              vk::DeviceSize bytesPerFrame = k_defaultBytesPerFrame);
+    void destroy();
+
+    vk::DescriptorSetLayout setLayout() const { return descriptorSetLayout; }
+    // Adds what a pipeline layout needs for a constants block of the given size: a push constant range at
+    // offset 0, or the ring's set layout
+    void describeConstants(uint32_t size, vk::ShaderStageFlags stages, std::vector<vk::DescriptorSetLayout>& setLayouts,
+                           std::vector<vk::PushConstantRange>& pushConstantRanges) const;
+
+    // Starts writing into the slot's region, only once the frame that last used the slot has completed
+    void beginFrame(uint32_t slot);
+    // Thread-safe. Copies the block into the ring and returns its dynamic offset.
+    uint32_t write(const void* data, uint32_t size);
+    // Thread-safe. Pushes small blocks, writes larger ones into the ring and binds them at setIndex.
+    void bindConstants(vk::CommandBuffer commandBuffer, vk::PipelineLayout pipelineLayout, vk::ShaderStageFlags stages,
+                       uint32_t setIndex, const void* data, uint32_t size);
+    // Before the frame is submitted: one flush covering everything written into the slot, a no-op on coherent memory
+    void flush();
+
+    vk::DeviceSize bytesUsed() const { return head.load(std::memory_order_relaxed); }
+
+private:
+    vk::Device device;
+    DeviceAllocator* allocator = nullptr;
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::DescriptorPool descriptorPool;
+    vk::DescriptorSet descriptorSet;
+    vk::Buffer buffer;
+    Allocation allocation;
+
+    vk::DeviceSize alignment = 256;
+    vk::DeviceSize regionSize = 0;
+    vk::DeviceSize regionStart = 0;
+    std::atomic<vk::DeviceSize> head{0}; // relative to regionStart
+};
@@ -0,0 +1,370 @@
+#include "upload_manager.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Everything the graphics queue may do with freshly uploaded data
+const vk::AccessFlags k_acquireAccess = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead
+    | vk::AccessFlagBits::eIndirectCommandRead | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead
+    | vk::AccessFlagBits::eTransferRead;
+
+const vk::ImageSubresourceRange k_colorMip0{vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1};
+}
+
+void UploadManager::init(vk::PhysicalDevice physicalDevice, vk::Device device, DeviceAllocator& allocator, FramePacer& framePacer,
+                         uint32_t transferFamily, vk::Queue transferQueue, uint32_t graphicsFamily, std::mutex* sharedQueueMutex,
+                         vk::DeviceSize stagingSize) {
+    this->device = device;
+    this->allocator = &allocator;
+    this->framePacer = &framePacer;
+    this->transferFamily = transferFamily;
+    this->transferQueue = transferQueue;
+    this->graphicsFamily = graphicsFamily;
+    this->sharedQueueMutex = sharedQueueMutex;
+    transferGranularity = physicalDevice.getQueueFamilyProperties()[transferFamily].minImageTransferGranularity;
+    acquireStages = vk::PipelineStageFlagBits::eDrawIndirect | vk::PipelineStageFlagBits::eVertexInput
+        | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader
+        | vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer;
+
+    stagingAlignment = std::max<vk::DeviceSize>(16, physicalDevice.getProperties().limits.optimalBufferCopyOffsetAlignment);
+    this->stagingSize = stagingSize;
+    chunkSize = std::max(stagingSize / 4 / stagingAlignment * stagingAlignment, stagingAlignment);
+    vk::BufferCreateInfo bufferInfo{};
+    bufferInfo.setSize(stagingSize)
+        .setUsage(vk::BufferUsageFlagBits::eTransferSrc)
+        .setSharingMode(vk::SharingMode::eExclusive);
+    stagingBuffer = allocator.createBuffer(bufferInfo, MemoryUsage::CpuToGpu, stagingAllocation);
+    head = 0;
+    usedBytes = 0;
+
+    vk::CommandPoolCreateInfo poolInfo{};
+    poolInfo.setFlags(vk::CommandPoolCreateFlagBits::eTransient | vk::CommandPoolCreateFlagBits::eResetCommandBuffer)
+        .setQueueFamilyIndex(transferFamily);
+    commandPool = device.createCommandPool(poolInfo);
+}
+
+void UploadManager::destroy() {
+    if (!commandPool) {
+        return;
+    }
+    waitIdle();
+    std::lock_guard<std::mutex> uploadLock(uploadMutex);
+    std::lock_guard<std::mutex> stateLock(stateMutex);
+    auto destroyBatch = [&](const std::unique_ptr<Batch>& batch) {
+        device.destroyFence(batch->fence);
+        device.destroySemaphore(batch->semaphore);
+    };
+    if (current) {
+        destroyBatch(current);
+        current.reset();
+    }
+    std::for_each(submitted.begin(), submitted.end(), destroyBatch);
+    std::for_each(freeBatches.begin(), freeBatches.end(), destroyBatch);
+    submitted.clear();
+    freeBatches.clear();
+    stagingInFlight.clear();
+    device.destroyCommandPool(commandPool); // frees the batch command buffers as well
+    commandPool = nullptr;
+    allocator->destroyBuffer(stagingBuffer, stagingAllocation);
+}
+
+UploadTicket UploadManager::uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size) {
+    if (size == 0) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    auto bytes = static_cast<const char*>(data);
+    for (vk::DeviceSize done = 0; done < size;) {
+        vk::DeviceSize chunk = std::min(size - done, chunkSize);
+        vk::DeviceSize offset = reserve(chunk);
+        memcpy(static_cast<char*>(stagingAllocation.mapped) + offset, bytes + done, chunk);
+        allocator->flush(stagingAllocation, offset, chunk);
+        bufferRegions(dst).push_back(vk::BufferCopy(offset, dstOffset + done, chunk));
+        done += chunk;
+    }
+    return current->serial;
+}
+
+UploadTicket UploadManager::uploadImage(vk::Image dst, vk::Extent2D extent, const void* data, vk::DeviceSize size, vk::ImageLayout finalLayout) {
+    if (size == 0 || extent.height == 0) {
+        return 0;
+    }
+    vk::DeviceSize rowPitch = size / extent.height;
+    uint32_t rowsPerChunk = extent.height;
+    // A granularity of (0,0,0) means the queue can only copy whole mip levels
+    if (transferGranularity.width != 0) {
+        rowsPerChunk = static_cast<uint32_t>(std::clamp<vk::DeviceSize>(chunkSize / rowPitch, 1, extent.height));
+        if (transferGranularity.height > 1) {
+            rowsPerChunk = std::max(rowsPerChunk / transferGranularity.height * transferGranularity.height, transferGranularity.height);
+        }
+    }
+    if (rowsPerChunk * rowPitch > stagingSize) {
+        throw std::runtime_error("image upload does not fit into the staging ring!");
+    }
+
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    auto bytes = static_cast<const char*>(data);
+    for (uint32_t y = 0; y < extent.height; y += rowsPerChunk) {
+        uint32_t rows = std::min(rowsPerChunk, extent.height - y);
+        vk::DeviceSize chunk = rows * rowPitch;
+        vk::DeviceSize offset = reserve(chunk);
+        memcpy(static_cast<char*>(stagingAllocation.mapped) + offset, bytes + y * rowPitch, chunk);
+        allocator->flush(stagingAllocation, offset, chunk);
+
+        if (current->imageCopies.empty() || current->imageCopies.back().image != dst || current->imageCopies.back().last) {
+            current->imageCopies.push_back({dst, finalLayout, y == 0, false, {}});
+        }
+        ImageCopy& copy = current->imageCopies.back();
+        vk::BufferImageCopy region{};
+        region.setBufferOffset(offset)
+            .setBufferRowLength(0) // tightly packed
+            .setBufferImageHeight(0)
+            .setImageSubresource({vk::ImageAspectFlagBits::eColor, 0, 0, 1})
+            .setImageOffset({0, static_cast<int32_t>(y), 0})
+            .setImageExtent({extent.width, rows, 1});
+        copy.regions.push_back(region);
+        copy.last = y + rows == extent.height;
+    }
+    return current->serial;
+}
+
+UploadTicket UploadManager::flush() {
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    submitCurrent();
+    releaseStaging(false);
+    return lastSubmitted;
+}
+
+void UploadManager::waitIdle() {
+    std::lock_guard<std::mutex> lock(uploadMutex);
+    submitCurrent();
+    while (!stagingInFlight.empty()) {
+        releaseStaging(true);
+    }
+}
+
+// Claims a contiguous staging range. The ring is consumed in order and released in submission order,
+// so used space is always the single range of usedBytes bytes ending at head.
+vk::DeviceSize UploadManager::reserve(vk::DeviceSize size) {
+    for (;;) {
+        releaseStaging(false);
+        if (usedBytes == 0) {
+            head = 0;
+        }
+        vk::DeviceSize offset = alignUp(head, stagingAlignment);
+        if (offset + size > stagingSize) {
+            offset = 0; // wrap around, the remainder at the end of the ring is skipped
+        }
+        vk::DeviceSize needed = (offset >= head ? offset - head : stagingSize - head + offset) + size;
+        if (usedBytes + needed <= stagingSize) {
+            if (!current) {
+                current = takeBatch();
+            }
+            usedBytes += needed;
+            current->stagingBytes += needed;
+            head = (offset + size) % stagingSize;
+            return offset;
+        }
+        // The ring is full: push out what was gathered and wait for the oldest transfer, never for the graphics queue
+        submitCurrent();
+        releaseStaging(true);
+    }
+}
+
+void UploadManager::submitCurrent() {
+    if (!current || (current->bufferCopies.empty() && current->imageCopies.empty())) {
+        return;
+    }
+    recordBatch(*current);
+    vk::SubmitInfo submitInfo{};
+    submitInfo.setCommandBufferCount(1)
+        .setPCommandBuffers(&current->commandBuffer)
+        .setSignalSemaphoreCount(1)
+        .setPSignalSemaphores(&current->semaphore);
+    {
+        std::unique_lock<std::mutex> queueLock;
+        if (sharedQueueMutex) {
+            queueLock = std::unique_lock<std::mutex>(*sharedQueueMutex);
+        }
+        transferQueue.submit(1, &submitInfo, current->fence);
+    }
+    lastSubmitted = current->serial;
+    stagingInFlight.push_back(current.get());
+    std::lock_guard<std::mutex> lock(stateMutex);
+    submitted.push_back(std::move(current));
+}
+
+// Returns the staging space of finished transfers. With wait set, blocks for the oldest one if nothing finished yet.
+void UploadManager::releaseStaging(bool wait) {
+    while (!stagingInFlight.empty()) {
+        Batch* batch = stagingInFlight.front();
+        if (device.getFenceStatus(batch->fence) != vk::Result::eSuccess) {
+            if (!wait) {
+                break;
+            }
+            (void)device.waitForFences(1, &batch->fence, true, UINT64_MAX);
+        }
+        wait = false;
+        usedBytes -= batch->stagingBytes;
+        stagingInFlight.pop_front();
+        std::lock_guard<std::mutex> lock(stateMutex);
+        batch->stagingReleased = true;
+    }
+}
+
+std::unique_ptr<UploadManager::Batch> UploadManager::takeBatch() {
+    std::unique_ptr<Batch> batch;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (!freeBatches.empty()) {
+            batch = std::move(freeBatches.back());
+            freeBatches.pop_back();
+        }
+    }
+    if (batch) {
+        device.resetFences(1, &batch->fence);
+        batch->stagingBytes = 0;
+        batch->bufferCopies.clear();
+        batch->imageCopies.clear();
+        batch->bufferAcquires.clear();
+        batch->imageAcquires.clear();
+        batch->stagingReleased = false;
+        batch->acquireFrame = 0;
+    } else {
+        batch = std::make_unique<Batch>();
+        vk::CommandBufferAllocateInfo allocInfo{};
+        allocInfo.setCommandPool(commandPool)
+            .setLevel(vk::CommandBufferLevel::ePrimary)
+            .setCommandBufferCount(1);
+        batch->commandBuffer = device.allocateCommandBuffers(allocInfo)[0];
+        batch->fence = device.createFence(vk::FenceCreateInfo());
+        batch->semaphore = device.createSemaphore(vk::SemaphoreCreateInfo());
+    }
+    batch->serial = nextSerial++;
+    return batch;
+}
+
+// Copies into the same buffer are issued as one vkCmdCopyBuffer with several regions
+std::vector<vk::BufferCopy>& UploadManager::bufferRegions(vk::Buffer buffer) {
+    for (auto& [dst, regions] : current->bufferCopies) {
+        if (dst == buffer) {
+            return regions;
+        }
+    }
+    current->bufferCopies.emplace_back(buffer, std::vector<vk::BufferCopy>{});
+    return current->bufferCopies.back().second;
+}
+
+void UploadManager::recordBatch(Batch& batch) {
+    vk::CommandBuffer commandBuffer = batch.commandBuffer;
+    commandBuffer.reset({});
+    commandBuffer.begin(vk::CommandBufferBeginInfo(vk::CommandBufferUsageFlagBits::eOneTimeSubmit));
+
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    for (const auto& copy : batch.imageCopies) {
+        if (copy.first) {
+            // Previous contents are discarded, the copy overwrites the whole mip level
+            imageBarriers.emplace_back(vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite,
+                                       vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+                                       VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED, copy.image, k_colorMip0);
+        }
+    }
+    if (!imageBarriers.empty()) {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, {},
+                                      0, nullptr, 0, nullptr, static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+
+    for (const auto& [buffer, regions] : batch.bufferCopies) {
+        commandBuffer.copyBuffer(stagingBuffer, buffer, static_cast<uint32_t>(regions.size()), regions.data());
+    }
+    for (const auto& copy : batch.imageCopies) {
+        commandBuffer.copyBufferToImage(stagingBuffer, copy.image, vk::ImageLayout::eTransferDstOptimal,
+                                        static_cast<uint32_t>(copy.regions.size()), copy.regions.data());
+    }
+
+    // Exclusive resources written on another queue family have to be released here and acquired by the graphics
+    // queue, with identical barriers on both sides. On a shared family the semaphore alone makes the writes visible.
+    bool transferOwnership = hasDedicatedQueue();
+    uint32_t srcFamily = transferOwnership ? transferFamily : VK_QUEUE_FAMILY_IGNORED;
+    uint32_t dstFamily = transferOwnership ? graphicsFamily : VK_QUEUE_FAMILY_IGNORED;
+    std::vector<vk::BufferMemoryBarrier> bufferReleases;
+    std::vector<vk::ImageMemoryBarrier> imageReleases;
+    if (transferOwnership) {
+        for (auto& [buffer, regions] : batch.bufferCopies) {
+            // Coalesce adjacent regions so large chunked uploads need a single barrier
+            std::sort(regions.begin(), regions.end(), [](const vk::BufferCopy& a, const vk::BufferCopy& b) { return a.dstOffset < b.dstOffset; });
+            vk::DeviceSize rangeStart = regions.front().dstOffset;
+            vk::DeviceSize rangeEnd = rangeStart;
+            for (size_t i = 0; i <= regions.size(); i++) {
+                if (i < regions.size() && regions[i].dstOffset <= rangeEnd) {
+                    rangeEnd = std::max(rangeEnd, regions[i].dstOffset + regions[i].size);
+                    continue;
+                }
+                bufferReleases.emplace_back(vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(), srcFamily, dstFamily,
+                                            buffer, rangeStart, rangeEnd - rangeStart);
+                batch.bufferAcquires.emplace_back(vk::AccessFlags(), k_acquireAccess, srcFamily, dstFamily,
+                                                  buffer, rangeStart, rangeEnd - rangeStart);
+                if (i < regions.size()) {
+                    rangeStart = regions[i].dstOffset;
+                    rangeEnd = rangeStart + regions[i].size;
+                }
+            }
+        }
+    }
+    for (const auto& copy : batch.imageCopies) {
+        if (!copy.last) {
+            continue;
+        }
+        imageReleases.emplace_back(vk::AccessFlagBits::eTransferWrite, vk::AccessFlags(),
+                                   vk::ImageLayout::eTransferDstOptimal, copy.finalLayout,
+                                   srcFamily, dstFamily, copy.image, k_colorMip0);
+        if (transferOwnership) {
+            batch.imageAcquires.emplace_back(vk::AccessFlags(), k_acquireAccess,
+                                             vk::ImageLayout::eTransferDstOptimal, copy.finalLayout,
+                                             srcFamily, dstFamily, copy.image, k_colorMip0);
+        }
+    }
+    if (!bufferReleases.empty() || !imageReleases.empty()) {
+        commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe, {}, 0, nullptr,
+                                      static_cast<uint32_t>(bufferReleases.size()), bufferReleases.data(),
+                                      static_cast<uint32_t>(imageReleases.size()), imageReleases.data());
+    }
+    commandBuffer.end();
+}
+
+void UploadManager::collectAcquires(vk::CommandBuffer commandBuffer, uint64_t frame,
+                                    std::vector<vk::Semaphore>& waitSemaphores, std::vector<vk::PipelineStageFlags>& waitStages) {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    // A batch can be reused once the loader is done with its staging range and the frame that waited on its semaphore finished
+    while (!submitted.empty() && submitted.front()->stagingReleased && submitted.front()->acquireFrame != 0
+           && framePacer->frameCompleted(submitted.front()->acquireFrame)) {
+        freeBatches.push_back(std::move(submitted.front()));
+        submitted.pop_front();
+    }
+
+    std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+    std::vector<vk::ImageMemoryBarrier> imageBarriers;
+    for (auto& batch : submitted) {
+        if (batch->acquireFrame != 0) {
+            continue;
+        }
+        batch->acquireFrame = frame;
+        bufferBarriers.insert(bufferBarriers.end(), batch->bufferAcquires.begin(), batch->bufferAcquires.end());
+        imageBarriers.insert(imageBarriers.end(), batch->imageAcquires.begin(), batch->imageAcquires.end());
+        waitSemaphores.push_back(batch->semaphore);
+        waitStages.push_back(acquireStages);
+        acquiredSerial.store(batch->serial, std::memory_order_release);
+    }
+    if (!bufferBarriers.empty() || !imageBarriers.empty()) {
+        // The source stages match the semaphore wait, so the acquire (and its layout transition) happens after the transfer
+        commandBuffer.pipelineBarrier(acquireStages, acquireStages, {}, 0, nullptr,
+                                      static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+                                      static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "vulkan_common.hpp"
+#include "memory_allocator.hpp"
+#include "frame_pacer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Serial of the transfer batch an upload ended up in, see UploadManager::isReady()
+using UploadTicket = uint64_t;
+
+// Streams buffer and image data to the GPU through a persistently mapped staging ring.
+// Copies are gathered into batches and submitted on the transfer queue (a dedicated transfer-only family
+// when the device has one). Each batch signals a binary semaphore that the next graphics frame waits on,
+// together with the queue family ownership acquire barriers collectAcquires() records into that frame.
+//
+// Uploads may be issued from loader threads while the render thread keeps drawing: the staging ring only
+// ever waits for the transfer queue, never for a graphics frame.
+class UploadManager {
+public:
+    static constexpr vk::DeviceSize k_defaultStagingSize = 32ull << 20;
+
+    // sharedQueueMutex must be the mutex guarding the graphics queue when transferQueue is that same queue
+    void init(vk::PhysicalDevice physicalDevice, vk::Device device, DeviceAllocator& allocator, FramePacer& framePacer,
+              uint32_t transferFamily, vk::Queue transferQueue, uint32_t graphicsFamily, std::mutex* sharedQueueMutex,
+              vk::DeviceSize stagingSize = k_defaultStagingSize);
+    void destroy();
+
+    bool hasDedicatedQueue() const { return transferFamily != graphicsFamily; }
+
+    // Both copy the data into the staging ring right away, so the source memory can be released on return.
+    // Data bigger than the ring is split into several copies.
+    UploadTicket uploadBuffer(vk::Buffer dst, vk::DeviceSize dstOffset, const void* data, vk::DeviceSize size);
+    // Fills mip 0 of a single-layer color image with tightly packed rows and leaves it in finalLayout
+    UploadTicket uploadImage(vk::Image dst, vk::Extent2D extent, const void* data, vk::DeviceSize size,
+                             vk::ImageLayout finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+    // Submits the copies gathered so far, returns the ticket of the submitted batch
+    UploadTicket flush();
+
+    // Render thread: records the ownership acquires of every submitted batch into the frame's command buffer
+    // and adds the semaphores the frame submission has to wait on.
+    void collectAcquires(vk::CommandBuffer commandBuffer, uint64_t frame,
+                         std::vector<vk::Semaphore>& waitSemaphores, std::vector<vk::PipelineStageFlags>& waitStages);
+    // True once the upload has been acquired by a frame recorded on the render thread, so draws recorded
+    // after that collectAcquires() call can use the resource.
+    bool isReady(UploadTicket ticket) const { return ticket <= acquiredSerial.load(std::memory_order_acquire); }
+
+    // Submits everything and waits for the transfer queue, used at shutdown and for blocking loads
+    void waitIdle();
+
+private:
+    struct ImageCopy {
+        vk::Image image;
+        vk::ImageLayout finalLayout;
+        bool first; // transitions the image into eTransferDstOptimal
+        bool last;  // releases (or transitions) the image to its final layout
+        std::vector<vk::BufferImageCopy> regions;
+    };
+    struct Batch {
+        UploadTicket serial = 0;
+        vk::CommandBuffer commandBuffer;
+        vk::Fence fence;
+        vk::Semaphore semaphore;
+        // Staging bytes owned by this batch, including padding skipped at the end of the ring
+        vk::DeviceSize stagingBytes = 0;
+        std::vector<std::pair<vk::Buffer, std::vector<vk::BufferCopy>>> bufferCopies;
+        std::vector<ImageCopy> imageCopies;
+        std::vector<vk::BufferMemoryBarrier> bufferAcquires;
+        std::vector<vk::ImageMemoryBarrier> imageAcquires;
+        bool stagingReleased = false;
+        uint64_t acquireFrame = 0;
+    };
+
+    vk::DeviceSize reserve(vk::DeviceSize size);
+    void submitCurrent();
+    void releaseStaging(bool wait);
+    std::unique_ptr<Batch> takeBatch();
+    std::vector<vk::BufferCopy>& bufferRegions(vk::Buffer buffer);
+    void recordBatch(Batch& batch);
+
+    vk::Device device;
+    DeviceAllocator* allocator = nullptr;
+    FramePacer* framePacer = nullptr;
+    uint32_t transferFamily = 0;
+    uint32_t graphicsFamily = 0;
+    vk::Queue transferQueue;
+    std::mutex* sharedQueueMutex = nullptr;
+    vk::Extent3D transferGranularity;
+    // Everything the graphics side may read from the transfer writes
+    vk::PipelineStageFlags acquireStages;
+
+    vk::Buffer stagingBuffer;
+    Allocation stagingAllocation;
+    vk::DeviceSize stagingSize = 0;
+    vk::DeviceSize stagingAlignment = 16;
+    // Largest single copy, keeps big uploads flowing through the ring in pieces
+    vk::DeviceSize chunkSize = 0;
+
+    // Loader side: ring state, the batch being gathered and the command pool, guarded by uploadMutex
+    std::mutex uploadMutex;
+    vk::CommandPool commandPool;
+    vk::DeviceSize head = 0;
+    vk::DeviceSize usedBytes = 0;
+    std::unique_ptr<Batch> current;
+    // Submitted batches still reading from the staging ring, oldest first
+    std::deque<Batch*> stagingInFlight;
+    UploadTicket nextSerial = 1;
+    UploadTicket lastSubmitted = 0;
+
+    // Shared with the render thread, guarded by stateMutex
+    std::mutex stateMutex;
+    std::deque<std::unique_ptr<Batch>> submitted;
+    std::vector<std::unique_ptr<Batch>> freeBatches;
+    std::atomic<UploadTicket> acquiredSerial{0};
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+// Common Vulkan include preamble, every translation unit talking to Vulkan must go through this header
+// so that the dispatch configuration stays identical across the whole program.
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifdef __ANDROID__
+#include <android/asset_manager.h>
+#include <jni.h>
+#include <android/asset_manager_jni.h>
+#include "vulkan-wrapper-patch.h"
+#include <vulkan_wrapper.h>
+#undef VK_NO_PROTOTYPES
+#endif
+#include <vulkan/vulkan.hpp>
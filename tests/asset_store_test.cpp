@@ -0,0 +1,92 @@
+#include "asset_store.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+// Desktop AssetStore and MappedFile: mapping, path resolution, error cases and handle moves
+namespace {
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+void checkThrows(const std::function<void()>& function, const std::string& what) {
+    try {
+        function();
+    } catch (const std::runtime_error&) {
+        return;
+    }
+    check(false, what + " throws");
+}
+
+bool contains(const Asset& asset, const std::string& expected) {
+    return asset.bytes().size() == expected.size() && std::memcmp(asset.bytes().data(), expected.data(), expected.size()) == 0;
+}
+
+void writeFile(const std::filesystem::path& path, const std::string& contents) {
+    std::ofstream file(path, std::ios::binary);
+    file << contents;
+}
+}
+
+int main() {
+    const std::filesystem::path root = std::filesystem::temp_directory_path() / "naru_asset_store_test";
+    std::filesystem::remove_all(root);
+    std::filesystem::create_directories(root);
+    const std::string contents = "naru asset store";
+    writeFile(root / "asset.bin", contents);
+    writeFile(root / "empty.bin", "");
+
+    AssetStore assets;
+    assets.init(root.string());
+
+    {
+        MappedFile file((root / "asset.bin").string());
+        check(file.size() == contents.size() && std::memcmp(file.data(), contents.data(), contents.size()) == 0, "MappedFile maps the whole file");
+        MappedFile moved(std::move(file));
+        check(file.data() == nullptr && file.size() == 0, "moved-from MappedFile is empty");
+        check(moved.size() == contents.size(), "moved-to MappedFile keeps the mapping");
+    }
+
+    Asset asset = assets.open("asset.bin");
+    check(asset.isOpen() && contains(asset, contents), "relative path resolves against the root");
+
+    // An absolute path outside the root must not be prefixed with it
+    const std::filesystem::path outside = std::filesystem::temp_directory_path() / "naru_asset_store_test_outside.bin";
+    writeFile(outside, "outside");
+    check(contains(assets.open(std::filesystem::absolute(outside).string()), "outside"), "absolute path bypasses the root");
+    std::filesystem::remove(outside);
+
+    checkThrows([&] { assets.open("missing.bin"); }, "missing asset");
+    checkThrows([&] { assets.open("empty.bin"); }, "empty asset");
+    checkThrows([&] { MappedFile file((root / "missing.bin").string()); }, "missing MappedFile");
+
+    // The bytes belong to the mapping, so a span taken before a move stays valid in the new handle
+    std::span<const std::byte> bytes = asset.bytes();
+    Asset moved = std::move(asset);
+    check(!asset.isOpen() && asset.bytes().empty(), "moved-from Asset is closed");
+    check(moved.bytes().data() == bytes.data() && moved.bytes().size() == bytes.size(), "span survives an Asset move");
+    check(std::memcmp(bytes.data(), contents.data(), contents.size()) == 0, "span still reads the file after the move");
+    Asset assigned;
+    assigned = std::move(moved);
+    check(assigned.bytes().data() == bytes.data() && contains(assigned, contents), "span survives a move assignment");
+
+    assigned = Asset(); // Windows cannot delete a mapped file
+    std::filesystem::remove_all(root);
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "asset store: all checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
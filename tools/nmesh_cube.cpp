@@ -0,0 +1,105 @@
+#include "mesh_file.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+// Writes a unit cube as a .nmesh file, a sample asset for --mesh and a reference for the layout in src/mesh_file.hpp:
+// one interleaved stream of position and normal, 16 bit indices and a single submesh.
+namespace {
+struct Vertex {
+    float position[3];
+    float normal[3];
+};
+
+constexpr uint32_t k_faceCount = 6;
+
+void append(std::vector<std::byte>& file, const void* data, size_t size) {
+    const auto* bytes = static_cast<const std::byte*>(data);
+    file.insert(file.end(), bytes, bytes + size);
+}
+
+void alignTo(std::vector<std::byte>& file, uint64_t alignment) {
+    file.resize((file.size() + alignment - 1) / alignment * alignment);
+}
+
+std::vector<std::byte> buildCube() {
+    std::vector<Vertex> vertices;
+    std::vector<uint16_t> indices;
+    for (uint32_t face = 0; face < k_faceCount; face++) {
+        // Face normal along one axis, the other two axes span the face
+        int axis = face / 2;
+        float sign = face % 2 == 0 ? 1.0f : -1.0f;
+        int u = (axis + 1) % 3, v = (axis + 2) % 3;
+        auto base = static_cast<uint16_t>(vertices.size());
+        for (uint32_t corner = 0; corner < 4; corner++) {
+            Vertex vertex{};
+            vertex.position[axis] = 0.5f * sign;
+            vertex.position[u] = (corner == 1 || corner == 2) ? 0.5f : -0.5f;
+            vertex.position[v] = (corner >= 2 ? 0.5f : -0.5f) * sign; // keeps the winding counter-clockwise from outside
+            vertex.normal[axis] = sign;
+            vertices.push_back(vertex);
+        }
+        indices.insert(indices.end(), {base, uint16_t(base + 1), uint16_t(base + 2), base, uint16_t(base + 2), uint16_t(base + 3)});
+    }
+
+    MeshFileHeader header{};
+    header.magic = k_meshFileMagic;
+    header.version = k_meshFileVersion;
+    header.streamCount = 1;
+    header.attributeCount = 2;
+    header.submeshCount = 1;
+    header.indexType = VK_INDEX_TYPE_UINT16;
+    header.vertexCount = vertices.size();
+    header.indexCount = indices.size();
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = -0.5f;
+        header.boundsMax[i] = 0.5f;
+    }
+    MeshFileStream stream{};
+    stream.stride = sizeof(Vertex);
+    MeshFileAttribute attributes[] = {
+        {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)},
+        {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)},
+    };
+    MeshFileSubmesh submesh{0, static_cast<uint32_t>(indices.size()), 0, 0};
+
+    // The tables have a fixed size, so the data offsets are known before anything is written
+    uint64_t tablesEnd = sizeof(MeshFileHeader) + sizeof(MeshFileStream) + sizeof(attributes) + sizeof(MeshFileSubmesh);
+    stream.offset = (tablesEnd + k_meshFileAlignment - 1) / k_meshFileAlignment * k_meshFileAlignment;
+    uint64_t streamEnd = stream.offset + vertices.size() * sizeof(Vertex);
+    header.indexOffset = (streamEnd + k_meshFileAlignment - 1) / k_meshFileAlignment * k_meshFileAlignment;
+
+    std::vector<std::byte> file;
+    append(file, &header, sizeof(header));
+    append(file, &stream, sizeof(stream));
+    append(file, attributes, sizeof(attributes));
+    append(file, &submesh, sizeof(submesh));
+    alignTo(file, k_meshFileAlignment);
+    append(file, vertices.data(), vertices.size() * sizeof(Vertex));
+    alignTo(file, k_meshFileAlignment);
+    append(file, indices.data(), indices.size() * sizeof(uint16_t));
+    return file;
+}
+}
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "usage: " << argv[0] << " <output.nmesh>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    try {
+        std::vector<std::byte> file = buildCube();
+        std::ofstream out(argv[1], std::ios::binary);
+        if (!out.write(reinterpret_cast<const char*>(file.data()), file.size())) {
+            throw std::runtime_error(std::string("failed to write ") + argv[1] + "!");
+        }
+        std::cout << "Wrote " << argv[1] << " (" << file.size() << " bytes)" << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error:" << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}